@@ -35,6 +35,7 @@ namespace fasstv::cli {
 		Encode,
 		Decode,
 		Transcode,
+		Scan,
 		Invalid
 	};
 
@@ -58,15 +59,39 @@ namespace fasstv::cli {
 			int image_resize_method = SWS_BICUBIC;
 
 			float noise_strength = 0.f;
+
+			bool planar_yuv = false; // feed YRYBY modes a YUV420P frame instead of RGB pixels
+
+			std::vector<SSTV::LineBand> line_bands {}; // empty to send the whole image
+
+			float airtime_budget = 0.f; // seconds, 0 to disable
+			SSTVMetadata::ModeConstraints airtime_constraints {};
+
+			std::filesystem::path cache_path {}; // empty to disable the encode cache
+			int cache_size = 512; // MiB
 		} encode;
 
 		struct DecodeOptions {
-			std::string microphone {};
+			std::string microphone {}; // empty to decode the input file instead
+			bool preview = false; // show lines as they come in, live only
+			int progress_lines = 0; // write the partial image every this many lines, 0 to disable
+			float progress_seconds = 0.f; // same, but on a timer
+			bool from_start = false; // skip looking for the VIS
+			bool vis_only = false; // don't fall back to working the mode out from the lines
+			std::filesystem::path previous_image {}; // partial transmissions patch into this instead of black, empty for none
+			int threads = 0; // 0 for one per core
+			SSTVDemodulator::Type demodulator = SSTVDemodulator::Type::Cordic;
 		} decode;
 
 		struct TranscodeOptions {
 			bool resize_mode_to_image = false;
 		} transcode;
+
+		struct ScanOptions {
+			int threads = 0; // 0 for one per core
+			int entry = -1; // only decode this transmission from the index, -1 for all of them
+			bool rescan = false; // ignore the index next to the recording
+		} scan;
 	};
 
 	class Options {
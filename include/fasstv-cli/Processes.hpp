@@ -4,6 +4,17 @@
 
 #include <SDL3/SDL.h>
 
+#include <libfasstv/SSTVEncode.hpp>
+#include <libfasstv/SSTVScanner.hpp>
+
+#include <shared/ImportUtilities.hpp>
+#include <shared/ProgressiveImageWriter.hpp>
+#include <shared/RingBuffer.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 namespace fasstv::cli {
 
 	class Processes {
@@ -13,15 +24,43 @@ namespace fasstv::cli {
 		int ProcessEncode();
 		int ProcessDecode();
 		int ProcessTranscode();
+		int ProcessScan();
 
 	private:
 		void OutputSamples(std::filesystem::path& outputPath);
 		void OutputImage(std::vector<float>& samples, std::filesystem::path& outputPath);
+		bool SaveDecodedImage(std::filesystem::path& outputPath);
+		void LogTranscodeError();
+		void OutputScanImage(const SSTVScanner::DecodedImage& image, int index, int samplerate);
 
 		int Audio_Setup();
 		void Audio_PumpOutputStream();
 		int Encode_RescaleAndLetterboxImage();
 
+		// converts surf_out to YUV420P and hands it to the encoder, as long as it scans the same as the RGB pixels
+		bool Encode_SetupPlanarYUV();
+
+		// push a whole recording into the decoder, returning how many samples went in
+		size_t Decode_PushMappedWAV(const MappedWAV& wav);
+		size_t Decode_PushAVAudio(AVAudioReader& reader);
+
+		// where the image being decoded goes, numbered per transmission when live
+		std::filesystem::path Decode_GetImagePath() const;
+		void Decode_SetupProgressiveOutput();
+
+		// hands --previous to the decoder for partial transmissions to patch into
+		bool Decode_LoadPreviousImage();
+
+		// live decoding off a microphone. the audio callback fills a ring that a worker thread decodes out of,
+		// while this thread just handles events and the preview
+		int Decode_Microphone();
+		SDL_AudioDeviceID Decode_FindRecordingDevice(const std::string& name);
+		void Decode_MicrophoneWorker();
+		void Decode_SaveLiveImage();
+		void Decode_RenderPreview();
+		static void SDLCALL Decode_RecordingCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+		static void Decode_OnScanline(int line, const std::uint8_t* pixels, int width);
+
 		bool sdl_run = true;
 		SDL_Event event {};
 
@@ -30,9 +69,41 @@ namespace fasstv::cli {
 		SDL_Surface* surf_orig = nullptr;
 		SDL_Surface* surf_out = nullptr;
 
+		std::vector<std::uint8_t> yuv_buffer {};
+		SSTVEncode::PlanarYUV yuv_frame {};
+		static constexpr float yuv_max_luma_error_hz = 16.f; // a few levels of rounding between swscale and ScanYRYBY
+
 		SDL_AudioStream* audio_stream = nullptr;
 		static constexpr size_t buffer_size = 320;
 		float speaker_buffer[buffer_size] {};
+
+		static constexpr size_t decode_block_size = 16384; // samples pushed to the decoder at a time when reading files
+		static constexpr size_t mapped_block_size = 1 << 20; // same, for WAVs read in place
+
+		std::unique_ptr<RingBuffer<float>> recording_ring {};
+		std::vector<float> recording_buffer {}; // only touched by the audio callback
+		std::atomic<size_t> recording_dropped = 0;
+		std::atomic<bool> live_run = true;
+		int live_samplerate = 0;
+		int live_images = 0; // transmissions saved so far, for numbering
+		int emitted_lines = 0; // lines of the current transmission that made it out
+
+		std::unique_ptr<ProgressiveImageWriter> progress_writer {}; // null unless partial images were asked for
+
+		// the worker writes lines in, the main thread uploads them when it gets around to it
+		std::mutex preview_mutex;
+		std::vector<std::uint8_t> preview_pixels {};
+		int preview_width = 0, preview_lines = 0;
+		bool preview_dirty = false;
+		SDL_Window* preview_window = nullptr;
+		SDL_Renderer* preview_renderer = nullptr;
+		SDL_Texture* preview_texture = nullptr;
+		int preview_texture_width = 0, preview_texture_lines = 0;
+
+		static constexpr float live_ring_seconds = 4.f; // how far decoding can fall behind before audio gets dropped
+		static constexpr size_t live_block_size = 2048; // samples popped off the ring at a time
+		static constexpr int live_idle_ms = 5; // how long the worker sleeps when the ring runs dry
+		static constexpr int live_poll_ms = 16; // how often the main thread looks at events and the preview
 	};
 
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include <array>
 #include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -31,6 +33,7 @@ namespace fasstv {
 			Pulse,
 			Porch,
 			Scan,
+			Skip, // zero length, jumps ahead by (pitch) lines. used by partial transmissions
 			Any
 		};
 
@@ -69,6 +72,45 @@ namespace fasstv {
 			int instruction_loop_start;
 		};
 
+		enum class ParametricLayout : std::uint8_t {
+			RGB,      // sequential R, G, B scans (like Block57)
+			YCrCb420, // Y every line, R-Y/B-Y on alternating lines (like Robot 36)
+			YCrCb422  // Y, R-Y, B-Y every line (like Robot 72)
+		};
+
+		struct ParametricModeParams {
+			std::uint16_t width;
+			std::uint16_t lines;
+			ParametricLayout layout;
+			float pixel_dwell_us; // time spent on one pixel of a (luma/color) scan
+
+			bool operator==(const ParametricModeParams& other) const = default;
+		};
+
+		// a range of lines to send in a partial transmission
+		struct LineBand {
+			std::uint16_t first;
+			std::uint16_t count;
+		};
+
+		// partial transmissions carry their bands in a header extension after the VIS:
+		// a marker tone, the band count, each band's first loop and loop count, then parity and a stop bit.
+		// the marker sits below sync for two bits' worth, which nothing a mode sends after its VIS can look like
+		static constexpr int BAND_HEADER_MAX_BANDS = 15;
+		static constexpr int BAND_HEADER_COUNT_BITS = 4;
+		static constexpr int BAND_HEADER_LOOP_BITS = 10;
+		static constexpr float BAND_HEADER_MARKER_FREQ = 1100;
+		static constexpr int BAND_HEADER_MARKER_BITS = 2;
+
+		// VIS codes for parametric modes, nothing standard lives up here. the VIS is PARAMETRIC_VIS_FIRST + the layout,
+		// and the rest of the parameters follow it in a header extension (before any band header):
+		// width, lines, the pixel dwell in 1/PARAMETRIC_DWELL_STEPS_PER_US steps, then parity and a stop bit
+		static constexpr std::uint8_t PARAMETRIC_VIS_FIRST = 120;
+		static constexpr std::uint8_t PARAMETRIC_VIS_LAST = 127;
+		static constexpr int PARAMETRIC_HEADER_SIZE_BITS = 12;
+		static constexpr int PARAMETRIC_HEADER_DWELL_BITS = 16;
+		static constexpr int PARAMETRIC_DWELL_STEPS_PER_US = 10;
+
 		const float VOX_FREQS[3] {1500, 1900, 2300}; // low, mid, high
 		const float VOX_LENGTH_MS = 100; // length per instruction
 		const float VIS_FREQS[2] {1200, 1900}; // break, leader
@@ -367,14 +409,31 @@ namespace fasstv {
 			},
 		};
 
+		// modes built at runtime. deque so pointers to them stay valid as more are added.
+		// decoders make them as they read parametric headers, so touch these under PARAMETRIC_MUTEX
+		std::deque<Mode> PARAMETRIC_MODES {};
+		std::vector<ParametricModeParams> PARAMETRIC_MODE_PARAMS {};
+		std::recursive_mutex PARAMETRIC_MUTEX {};
+
 		SSTV();
 
 		static Mode* GetMode(const std::string_view& name);
 		static Mode* GetMode(int vis_code);
 
-		static void CreateInstructions(std::vector<Instruction>& instructions, const Mode* mode, bool clear = true);
+		static Mode* CreateParametricMode(const ParametricModeParams& params);
+		static bool GetParametricParams(const Mode* mode, ParametricModeParams& params);
+		static bool IsParametricVIS(int vis_code) { return vis_code >= PARAMETRIC_VIS_FIRST && vis_code <= PARAMETRIC_VIS_LAST; }
+
+		static int GetLinesPerLoop(const Mode* mode);
+		static std::vector<LineBand> GetLoopBands(const Mode* mode, const std::vector<LineBand>& line_bands);
+		// whether loop_bands could have come out of GetLoopBands for mode, as a check on a band header that was read
+		static bool AreLoopBandsValid(const Mode* mode, const std::vector<LineBand>& loop_bands);
+
+		static void CreateInstructions(std::vector<Instruction>& instructions, const Mode* mode, bool clear = true, const std::vector<LineBand>* loop_bands = nullptr);
 		static void CreateVOXHeader(std::vector<Instruction>& instructions);
 		static void CreateVISHeader(std::vector<Instruction>& instructions, std::uint8_t vis_code);
+		static void CreateParametricHeader(std::vector<Instruction>& instructions, const ParametricModeParams& params);
+		static void CreateBandHeader(std::vector<Instruction>& instructions, const std::vector<LineBand>& loop_bands);
 		static void CreateFooter(std::vector<Instruction>& instructions);
 	};
 
@@ -6,50 +6,228 @@
 #include <SDL3/SDL.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <string_view>
 #include <vector>
 
+#include "SSTVDemodulator.hpp"
+#include "SSTVLineDetector.hpp"
 #include "SSTVMetadata.hpp"
+#include "SSTVResampler.hpp"
+#include "SSTVStartDetector.hpp"
 
 namespace fasstv {
 
-	#ifdef FASSTV_DEBUG
-	struct AverageFreqDebugInfo {
+	class ThreadPool;
+
+	// trace points (and the checks that are only there for them) compile away outside of debug builds
+#ifdef FASSTV_DEBUG
+	inline constexpr bool DECODE_TRACING = true;
+#else
+	inline constexpr bool DECODE_TRACING = false;
+#endif
+
+	// one frequency measurement, for the debug window
+	struct DecodeTraceEntry {
 		float pos_ms {};
 		int width_samples {};
-		float freq_expected {};
+		float freq_expected {}; // NAN if we weren't expecting anything
 		float freq_margin {};
-		float freq_back {}; // callback
+		float freq_back {};
 		float ret {};
-		std::string debug_text {};
+		char label[32] {};
+		int field = -1; // scan pixels only
+		int pixel = -1;
 	};
 
-	// vaguely new (c++17) thing I didn't know about, thanks CLion
-	// inline keyword works around the one definition rule. easier than defining and using an extern!
-	inline std::vector<AverageFreqDebugInfo> debug_AverageFreqInfo{};
-	#endif
+	// how well one line came through, from what decoding it measured anyway
+	struct DecodeLineQuality {
+		bool decoded = false; // lines that weren't sent (or weren't heard) stay false and count for nothing
+		float sync_error_ms = NAN; // how far the sync landed off the line fit, NAN if there wasn't one to hear
+		float tone_error_hz = 0.f; // mean distance of the syncs, porches and separators from where they should be
+		float snr_db = 0.f; // the video range (800Hz) against how much those tones wobble
+		float clipped = 0.f; // fraction of pixels past black or white
+		float score = 0.f; // 0-1, all of the above together
+	};
 
 	class SSTVDecode {
 	public:
 		static constexpr int NUM_CHANNELS = 4; // bumping to 4 to experiment with alpha values
 		static constexpr int NUM_WORK_BUFFERS = NUM_CHANNELS;
+		static constexpr int INTERNAL_SAMPLERATE = 22050; // what anything faster is resampled to before demodulating. any lower and Martin and Scottie lose detail
 
 		static SSTVDecode& The();
 
+		// called with each line as soon as nothing else can change it, RGBA8888
+		typedef void (*ScanlineCallback)(int line, const std::uint8_t* pixels, int width);
+
 		~SSTVDecode();
 
-		void DecodeSamples(std::vector<float>& samples, int samplerate, SSTV::Mode* expectedMode = nullptr, bool expectedFallback = false);
+		// samples are read in place, never copied. int16 is full scale at +-32768
+		void DecodeSamples(std::span<const float> samples, int samplerate, SSTV::Mode* expectedMode = nullptr, bool expectedFallback = false);
+		void DecodeSamples(std::span<const std::int16_t> samples, int samplerate, SSTV::Mode* expectedMode = nullptr, bool expectedFallback = false);
+
+		// for live feeds: start, push samples as they come in, then finish to flush whatever's left.
+		// only about a line's worth of samples is kept around, however much gets pushed at once
+		void StartStream(int samplerate, SSTV::Mode* expectedMode = nullptr, bool expectedFallback = false);
+		void PushSamples(std::span<const float> samples);
+		void PushSamples(std::span<const std::int16_t> samples);
+		void FinishStream();
+
+		void SetScanlineCallback(ScanlineCallback cb) { scanline_callback = cb; }
+
+		// how audio becomes frequency, takes effect from the next stream
+		void SetDemodulator(SSTVDemodulator::Type type) { demodulator_type = type; }
+
+		// resample anything above INTERNAL_SAMPLERATE down to it first, instead of demodulating at whatever rate the input is at.
+		// slower input is always demodulated as it is
+		void SetResampling(bool resample) { resampling = resample; }
+
+		// look for the VIS instead of assuming the transmission starts with the first sample
+		void SetStartSearch(bool search) { start_search = search; }
+
+		// when there's no VIS to be read, work the mode out from the lines instead of giving up.
+		// only the expected mode is considered, if there is one
+		void SetLineDetection(bool detect) { line_detection = detect; }
+
+		// line up every line against its sync pulse, correcting for sound card clock error (slant)
+		void SetSyncTracking(bool track) { sync_tracking = track; }
+
+		// clock error already measured for what's about to be decoded (SSTVScanner's skew_ppm), so the sync fit
+		// starts from it rather than from none. NAN to work it out from the syncs alone
+		void SetExpectedSkew(float ppm) { expected_slope = std::clamp(ppm * 1e-6, -SYNC_MAX_SLOPE, SYNC_MAX_SLOPE); }
+
+		// decode scans on this pool once their timing is known, nullptr to keep everything on the calling thread.
+		// the pool has to outlive the decode
+		void SetThreadPool(ThreadPool* pool) { thread_pool = pool; }
+
+		// keep the last image around, so partial transmissions of the same mode patch into it
+		void SetRetainImage(bool retain) { retain_image = retain; }
+
+		// start from this image (RGBA8888, the mode's size) instead of black, as if it were retained from
+		// an earlier transmission of mode. turns retaining on
+		bool LoadRetainedImage(SSTV::Mode* mode, const std::uint8_t* pixels, int width, int height, int pitch);
 
 		SSTV::Mode* GetMode() const { return decoded_mode; }
 		std::uint8_t* GetPixels(size_t* out_size) const;
 
+		// one per line of the mode, each filled in as its line is emitted
+		std::span<const DecodeLineQuality> GetLineQuality() const { return line_quality; }
+
+		// every metric averaged over the decoded lines, score included
+		DecodeLineQuality GetImageQuality() const;
+
 		bool HasStarted() const { return has_started; }
 		bool IsDone() const { return is_done; }
 
 	private:
-		void FreeBuffers();
+		static constexpr float SYNC_SEARCH_MS = 3.f; // how far from where we think a sync is to look for it
+		static constexpr float SYNC_EDGE_MS = 2.f; // how much either side of the sync's end the filter looks at
+		static constexpr float SYNC_MAX_FREQ = 1350.f; // any higher on average and it's not a sync
+		static constexpr float SYNC_PORCH_FREQ = 1500.f; // what every mode steps up to out of its sync
+		static constexpr float SYNC_PORCH_SLACK = 150.f; // noise on the porch still counts for this much over it
+		static constexpr float SYNC_MIN_STEP = 75.f; // the step up to the porch is 300Hz, less once the filter smears it
+		static constexpr float SYNC_MAX_RESIDUAL_MS = 1.f; // further than this off the fit is ignored
+		static constexpr int SYNC_MIN_FOR_REJECTION = 4;
+		static constexpr int SYNC_MIN_FOR_BIAS = 8;
+		static constexpr double SYNC_MAX_SLOPE = 0.01; // 1%, worse than any sound card
+
+		static constexpr int PUSH_WINDOW = 16384; // samples demodulated per step of a big push
+
+		static constexpr float DETECT_INTERVAL_MS = 500.f; // how much more track there has to be before the line detector has another go
+		static constexpr int DETECT_MAX_WINDOWS = 3; // after a bad VIS, how many of the line detector's windows to try for before giving up
+		static constexpr int DETECT_MIN_SYNC_BLOCKS = 4; // what the start detector has to hear in a window of the line detector's before there's any point looking for lines
+
+		static constexpr float QUALITY_EDGE_MS = 1.f; // left off either end of a tone before it's measured
+		static constexpr float QUALITY_CLIP_MARGIN_HZ = 25.f; // past black or white by less than this is just the demodulator rippling
+		static constexpr float QUALITY_MAX_TONE_ERROR_HZ = 100.f; // tones this far off (or syncs SYNC_MAX_RESIDUAL_MS) score nothing
+		static constexpr float QUALITY_FULL_SNR_DB = 30.f; // and this clean scores full marks
+
+		static constexpr int SCAN_BATCH = 64; // scans to queue up before handing them to the pool
+		static constexpr int ASSEMBLE_JOB_PIXELS = 16384; // pixels of image assembly per job, when there's a pool
+
+		// one scan with its timing worked out, all that's needed to read its pixels
+		struct PendingScan {
+			int line;
+			int field;
+			bool doubled;
+			double start_smp;
+			double pixel_smp;
+		};
+
+		enum class StreamState {
+			Searching,  // waiting for a VIS to show up
+			Header,     // VOX and VIS
+			ParametricHeader, // a parametric mode's parameters, after its VIS
+			BandMarker, // partial transmission band header, if any
+			BandCount,
+			BandBody,
+			Detecting,  // no usable VIS, working the mode out from the lines
+			Lines,
+			Done
+		};
 
-		float AverageFreqAtArea(float pos_ms, int width_samples = 10, std::string debug_text = "");
-		bool AverageFreqAtAreaExpected(float pos_ms, float freq_expected, float freq_margin = 50.f, int width_samples = 10, float* freq_back = nullptr, std::string debug_text = "");
+		void FreeBuffers();
+		void AllocateBuffers(SSTV::Mode* mode);
+
+		std::span<const float> SearchForStart(std::span<const float> samples);
+		void PushWindow(std::span<const float> samples);
+		void DemodulateSamples(std::span<const float> samples);
+
+		void RunStream();
+		bool StepHeader();
+		bool StepParametricHeader();
+		bool StepBandHeader();
+		bool RestartAfterBandHeader(); // not a band header after all, read the lines from where it would have started
+		bool StepLines();
+		bool StartLines();
+		bool PrepareLines(int first_loop = -1); // -1 for straight after the header, otherwise the loop the line detector found
+		void FinishLines(); // assemble whatever's left and call the stream done
+		int ReadHeaderBits(int bits);
+
+		bool StartLineDetection();
+		bool StepDetection();
+		bool SearchForLines();
+		bool DemodulateSearch(std::span<const float> samples);
+		void RebaseSearch();
+		bool StartDetectedLines(const SSTVLineDetector::Result& result);
+
+		bool HasSamplesUpTo(int smp) const;
+		void DiscardSamplesBefore(int smp);
+
+		void AdvanceProgress(float length_ms);
+		double GetTrackedSample(double nominal_smp) const;
+		bool IsLineSync(int instruction) const;
+		bool HasSyncPorch(int instruction) const; // followed by SYNC_PORCH_FREQ, which is what its edge gets matched against
+		double TrackSync(double predicted_smp, int width_samples, int search_smp); // how far off the fit it was in samples, NAN if not heard
+
+		void MeasureTone(float center_ms, float expected_freq, float freq_margin, int width_samples, std::string_view label);
+		void FinishLineQuality(int line);
+
+		void QueueScan(const PendingScan& scan);
+		void FlushScans();
+		void DecodeScan(const PendingScan& scan);
+
+		void EmitLinesBefore(int line);
+		void AssembleLines(int first, int end);
+		void AssembleLine(int y);
+
+		// work buffer (0.0-1.0 per field) to RGBA8888, alpha is left to AssembleLine
+		static void AssembleRowMonochrome(const float* work, std::uint8_t* pix, int width);
+		static void AssembleRowRGB(const float* work, std::uint8_t* pix, int width);
+		static void AssembleRowYRYBY(const float* work, std::uint8_t* pix, int width);
+		static inline int WorkToByte(float value) { return std::min(std::max(static_cast<int>(value * 255.f), 0), 255); }
+
+		double FreqIntegralTo(double smp) const;
+		float AverageFreqBetween(double from_smp, double to_smp) const;
+		float FreqVarianceBetween(int from_smp, int to_smp, float mean) const;
+		float AverageFreqAtArea(float pos_ms, int width_samples = 10, std::string_view label = {});
+		bool AverageFreqAtAreaExpected(float pos_ms, float freq_expected, float freq_margin = 50.f, int width_samples = 10, float* freq_back = nullptr, std::string_view label = {});
+
+		void Trace(float pos_ms, int width_samples, float freq_expected, float freq_margin, float freq_back, float ret, std::string_view label, int field = -1, int pixel = -1);
 
 		inline float TotalSamplesLengthInSeconds() const { return samples.size() / (float)samplerate; }
 
@@ -60,6 +238,9 @@ namespace fasstv {
 		inline float GetTimeAtSample(const int smp) const { return SamplesToSeconds(smp); }
 		inline int GetSampleAtTime(const float time) const { return SecondsToSamples(time); }
 
+		// for logging, counting from the start of the stream instead of from stream_base_smp
+		inline float GetStreamTimeAtSample(const double smp) const { return (stream_base_smp + smp) / samplerate; }
+
 #ifdef FASSTV_DEBUG
 		SDL_Renderer* debug_DebugWindowSetup();
 
@@ -109,9 +290,81 @@ namespace fasstv {
 		std::uint8_t* pixel_buf = nullptr;
 		size_t pixel_buf_size = 0;
 
-		int samplerate;
-		std::vector<float> samples;
+		int samplerate; // what the decoder runs at, after resampling
+		bool resampling = true;
+		SSTVResampler resampler;
+		std::vector<float> resampled; // the window being pushed, at samplerate
+		SSTVDemodulator::Type demodulator_type = SSTVDemodulator::Type::Cordic;
+		std::unique_ptr<SSTVDemodulator> demodulator; // everything is read this many samples late, see GetDelaySamples
+		std::vector<float> samples; // only kept for the debug window
 		std::vector<float> samples_freq;
+		std::vector<double> freq_prefix; // sum of samples_freq before each index, one longer than it
+		std::vector<double> sync_prefix; // TrackSync's own, around the edge it's looking for
+		int freq_start_smp = 0; // stream position of samples_freq[0]
+		// where the positions here count from, in the start detector's samples. moved up while searching, so however long
+		// that takes they only ever have to cover about a transmission
+		std::int64_t stream_base_smp = 0;
+
+		StreamState stream_state = StreamState::Done;
+		bool stream_finishing = false;
+		bool start_search = true;
+		SSTVStartDetector start_detector;
+		bool line_detection = true;
+		SSTVLineDetector line_detector;
+		int detect_reference_smp = -1; // where the lines should have started going by the header, -1 if there wasn't one
+		int detect_next_smp = 0;
+		int detect_give_up_smp = 0;
+		std::vector<SSTV::Instruction> instructions;
+		std::vector<DecodeTraceEntry> trace; // only filled with DECODE_TRACING
+		int inst_vis_start = 0;
+		int inst_vis_end = 0;
+		int cur_instruction = 0;
+		int progress_smp = 0;
+		double progress_frac = 0.0; // how far past progress_smp we really are, under a sample
+		int cur_line = -1;
+		int next_line_to_emit = 0;
+
+		std::uint8_t vis_code = 0;
+		SSTV::Mode* parametric_mode = nullptr; // what the parametric header after the VIS described, if there was one
+		std::vector<SSTV::LineBand> loop_bands;
+		int band_count = 0;
+		int band_header_smp = 0; // where the band marker was looked for
+		double band_header_frac = 0.0;
+		bool header_parity = false;
+
+		SSTV::Mode* expected_mode = nullptr;
+		bool expected_fallback = false;
+
+		ScanlineCallback scanline_callback = nullptr;
+
+		// where the lines really are: nominal + offset + slope * (nominal - origin), fit to the syncs
+		bool sync_tracking = true;
+		int sync_origin_smp = 0;
+		double sync_offset = 0.0;
+		double sync_slope = 0.0;
+		double sync_bias = 0.0; // how late the filter makes a sync look
+		double expected_slope = NAN; // held until there are enough syncs to fit it, NAN if nothing was expected
+		double sync_sum_x = 0.0, sync_sum_y = 0.0, sync_sum_xx = 0.0, sync_sum_xy = 0.0;
+		int sync_count = 0;
+
+		// per line, the tones are only ever measured on this thread, the scans can be anywhere so they count per field
+		struct LineToneSums {
+			double error_hz = 0.0;
+			int tones = 0;
+			double variance = 0.0; // weighted by samples
+			int samples = 0;
+			bool sync_expected = false; // there was a sync to listen for
+		};
+
+		std::vector<DecodeLineQuality> line_quality;
+		std::vector<LineToneSums> line_tones;
+		std::vector<int> scan_clipped; // line * NUM_WORK_BUFFERS + field, -1 if that scan never happened
+
+		ThreadPool* thread_pool = nullptr;
+		std::vector<PendingScan> pending_scans; // in stream order, only ever filled with a pool
+
+		bool retain_image = false;
+		SSTV::Mode* retained_mode = nullptr;
 
 		SSTV::Mode* decoded_mode = nullptr;
 		SSTVMetadata::PerModeMetadata* decoded_mode_meta = nullptr;
@@ -0,0 +1,132 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace fasstv {
+
+	// Turns audio into the frequency it's at, sample by sample.
+	// Every decoder has its own, so there's nothing shared between decodes running side by side.
+	// There's a few ways of doing it, trading accuracy for speed, picked with SSTVDecode::SetDemodulator.
+	class SSTVDemodulator {
+	public:
+		enum class Type {
+			Cordic,       // PicoSSTV's integer mixer, half band filter and CORDIC. the default
+			ZeroCrossing, // times the last few zero crossings. cheapest, worst in noise
+			Hilbert,      // float analytic signal, phase difference between samples
+			Goertzel      // strongest of a bank of short windowed DFTs, interpolated. slowest, steadiest
+		};
+
+		// everything is clamped to this, a little past the SSTV range
+		static constexpr float MIN_FREQ = 1000.f;
+		static constexpr float MAX_FREQ = 2400.f;
+
+		virtual ~SSTVDemodulator() = default;
+
+		static std::unique_ptr<SSTVDemodulator> Create(Type type);
+
+		static std::string_view GetTypeName(Type type);
+		static bool GetTypeByName(std::string_view name, Type& type);
+
+		virtual Type GetType() const = 0;
+
+		// forget everything from the last stream
+		virtual void Reset() = 0;
+
+		// writes count frequencies (Hz) to out, one per sample in
+		virtual void Process(const float* in, float* out, size_t count, int samplerate) = 0;
+
+		// how many samples late a change in frequency shows up in the output
+		virtual int GetDelaySamples(int samplerate) const = 0;
+	};
+
+	class CordicDemodulator : public SSTVDemodulator {
+	public:
+		static constexpr int BLOCK_SIZE = 256;
+		static constexpr int FILTER_HISTORY = 63; // how far back the half band filter reaches
+
+		Type GetType() const override { return Type::Cordic; }
+		void Reset() override;
+		void Process(const float* in, float* out, size_t count, int samplerate) override;
+		int GetDelaySamples(int /*samplerate*/) const override { return 35; } // half band filter plus smoothing, whatever the rate
+
+	private:
+		void ProcessBlock(const float* in, float* out, int count, int samplerate);
+
+		std::int16_t filter_i[FILTER_HISTORY + BLOCK_SIZE] {};
+		std::int16_t filter_q[FILTER_HISTORY + BLOCK_SIZE] {};
+		std::uint8_t mix_phase = 0;
+		std::int16_t last_phase = 0;
+		std::uint32_t smoothed_freq = 0;
+	};
+
+	class ZeroCrossingDemodulator : public SSTVDemodulator {
+	public:
+		static constexpr int HALF_PERIODS = 4; // half cycles averaged per estimate
+
+		Type GetType() const override { return Type::ZeroCrossing; }
+		void Reset() override;
+		void Process(const float* in, float* out, size_t count, int samplerate) override;
+		int GetDelaySamples(int samplerate) const override;
+
+	private:
+		float last_sample = 0.f;
+		double since_crossing = 0.0; // samples since the last crossing, fractional
+		double half_periods[HALF_PERIODS] {};
+		int next_half_period = 0;
+		int crossings_seen = 0;
+		float freq = MIN_FREQ;
+	};
+
+	class HilbertDemodulator : public SSTVDemodulator {
+	public:
+		static constexpr int TAPS = 31; // odd, so the real part lines up with a whole sample
+		static constexpr int BLOCK_SIZE = 256;
+
+		HilbertDemodulator();
+
+		Type GetType() const override { return Type::Hilbert; }
+		void Reset() override;
+		void Process(const float* in, float* out, size_t count, int samplerate) override;
+		int GetDelaySamples(int samplerate) const override;
+
+	private:
+		void ProcessBlock(const float* in, float* out, int count, int samplerate);
+
+		float kernel[TAPS] {};
+		float history[(TAPS - 1) + BLOCK_SIZE] {};
+		float last_i = 0.f;
+		float last_q = 0.f;
+		float smoothed_freq = 0.f;
+	};
+
+	class GoertzelDemodulator : public SSTVDemodulator {
+	public:
+		static constexpr float WINDOW_MS = 2.f;
+		static constexpr float BIN_SPACING = 100.f;
+		static constexpr int BINS = 17; // 900-2500Hz, so anything in range has a bin either side
+
+		Type GetType() const override { return Type::Goertzel; }
+		void Reset() override;
+		void Process(const float* in, float* out, size_t count, int samplerate) override;
+		int GetDelaySamples(int samplerate) const override;
+
+	private:
+		void Setup(int samplerate);
+
+		int setup_samplerate = 0;
+		int window = 0;
+
+		// windowed twiddles, every bin for one sample of the window then the next
+		std::vector<float> twiddle_re;
+		std::vector<float> twiddle_im;
+
+		std::vector<float> history; // last window-1 samples, oldest first
+	};
+
+} // namespace fasstv
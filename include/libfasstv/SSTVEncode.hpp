@@ -15,14 +15,27 @@ namespace fasstv {
 
 		typedef std::uint8_t* (*PixelProviderCallback)(int sample_x, int sample_y);
 
+		// A planar YUV frame (YUV420P, YUV422P, YUV444P...), as it comes out of a video decoder.
+		// Values are expected in studio range (16-235/16-240), which is what ScanYRYBY produces from RGB anyway.
+		struct PlanarYUV {
+			const std::uint8_t* planes[3] {}; // Y, U (Cb/B-Y), V (Cr/R-Y)
+			int strides[3] {};                // bytes per row of each plane
+			int width {};
+			int height {};
+			int chroma_shift_x {}; // log2 of horizontal chroma subsampling (1 for 4:2:0 and 4:2:2)
+			int chroma_shift_y {}; // log2 of vertical chroma subsampling (1 for 4:2:0)
+		};
+
 		void SetMode(const std::string_view& name);
 		void SetMode(int vis_code);
 		void SetMode(SSTV::Mode* mode);
 
+		void SetLineBands(const std::vector<SSTV::LineBand>& bands);
 		void SetSampleRate(int samplerate);
 		void SetLetterbox(Rect rect);
 		void SetLetterboxLines(bool b);
 		void SetPixelProvider(PixelProviderCallback cb);
+		void SetPlanarYUVSource(const PlanarYUV* yuv);
 		void SetInstructionTypeFilter(SSTV::InstructionType type, std::int8_t scan_id = -1);
 		void SetNoiseStrength(float strength);
 
@@ -41,8 +54,10 @@ namespace fasstv {
 		static float ScanMonochrome(SSTV::Instruction* ins, int pos_x, int pos_y, std::uint8_t* sampled_pixel);
 		static float ScanRGB(SSTV::Instruction* ins, int pos_x, int pos_y, std::uint8_t* sampled_pixel);
 		static float ScanYRYBY(SSTV::Instruction* ins, int pos_x, int pos_y, std::uint8_t* sampled_pixel);
+		static float ScanYRYBYPlanar(SSTV::Instruction* ins, const PlanarYUV* yuv, int sample_x, int sample_y);
 
 	   private:
+		int GetInstructionLength() const;
 		bool GetNextInstruction();
 		float GetSamplePitch(Rect rect);
 		float GetNoiseSample() const { return (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)) * noise_strength; }
@@ -59,17 +74,20 @@ namespace fasstv {
 		float phase = 0;
 
 		std::vector<SSTV::Instruction> instructions {};
+		std::vector<SSTV::LineBand> line_bands {}; // empty to send everything
 		std::vector<float> samples {};
 		std::int16_t cur_x = -1;
 		std::int16_t cur_y = -1;
 		std::uint32_t cur_sample = 0;
 		std::uint32_t last_instruction_sample = 0;
+		double sample_carry = 0.0; // how far past last_instruction_sample the instruction really started, under a sample
 
 		bool letterboxLines = false;
 		Rect letterbox {};
 		SSTV::InstructionType filter_inst_type {};
 		std::int8_t filter_scan_id {};
 		PixelProviderCallback pixProviderFunc {};
+		const PlanarYUV* yuvSource {};
 
 		float noise_strength {};
 	};
@@ -0,0 +1,83 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <libfasstv/SSTV.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace fasstv {
+
+	// On-disk cache of rendered transmissions, keyed by the image and every encoder parameter.
+	// Hits are memory-mapped straight out of the cache, so the encoder never runs.
+	class SSTVEncodeCache {
+	public:
+		// SHA-256 of the image and parameters, also written into the entry and checked on every hit
+		struct Key {
+			std::array<std::uint8_t, 32> digest {};
+
+			std::string ToString() const;
+		};
+
+		struct EncodeParams {
+			const SSTV::Mode* mode {};
+			int samplerate {};
+			float volume {};
+			float noise_strength {};
+			std::span<const SSTV::LineBand> line_bands {};
+		};
+
+		struct Stats {
+			std::uint64_t hits {};
+			std::uint64_t misses {};
+			std::uint64_t stores {};
+			std::uint64_t evictions {};
+		};
+
+		// PCM mapped from the cache, unmapped when this goes away
+		class MappedSamples {
+		public:
+			MappedSamples() = default;
+			~MappedSamples();
+
+			MappedSamples(const MappedSamples&) = delete;
+			MappedSamples& operator=(const MappedSamples&) = delete;
+			MappedSamples(MappedSamples&& other) noexcept;
+			MappedSamples& operator=(MappedSamples&& other) noexcept;
+
+			std::span<const float> GetSamples() const { return { reinterpret_cast<const float*>(static_cast<const std::uint8_t*>(data) + offset), (size - offset) / sizeof(float) }; }
+
+		private:
+			friend class SSTVEncodeCache;
+			void Unmap();
+
+			void* data = nullptr;
+			size_t size = 0;
+			size_t offset = 0; // past the entry header
+		};
+
+		SSTVEncodeCache(std::filesystem::path directory, std::uint64_t max_size_bytes);
+
+		// width * 4 bytes per row (RGBA8888), rows are pitch bytes apart
+		static Key MakeKey(const std::uint8_t* pixels, int width, int height, int pitch, const EncodeParams& params);
+
+		bool Lookup(const Key& key, MappedSamples& out);
+		bool Store(const Key& key, std::span<const float> samples);
+
+		const Stats& GetStats() const { return stats; }
+
+	private:
+		std::filesystem::path GetPath(const Key& key) const;
+		void Evict();
+
+		std::filesystem::path directory;
+		std::uint64_t max_size_bytes;
+
+		Stats stats {};
+	};
+
+} // namespace fasstv
@@ -0,0 +1,40 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <libfasstv/SSTVScanner.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	// What a scan found in a recording, saved next to it so single transmissions
+	// can be decoded again later without scanning the whole thing.
+	class SSTVIndex {
+	public:
+		struct RecordingHash {
+			std::uint64_t hash[2] {};
+
+			bool operator==(const RecordingHash& other) const = default;
+		};
+
+		// sparse, so checking it is cheap even on hours of audio.
+		// catches a different or edited recording, not every flipped bit
+		static RecordingHash HashRecording(std::span<const std::uint8_t> file_bytes);
+
+		// recording.wav -> recording.wav.fstidx
+		static std::filesystem::path GetSidecarPath(const std::filesystem::path& recording);
+
+		bool Save(const std::filesystem::path& path) const;
+		bool Load(const std::filesystem::path& path);
+
+		RecordingHash recording_hash {};
+		int samplerate = 0;
+		std::uint64_t sample_count = 0;
+		std::vector<SSTVScanner::Transmission> transmissions {};
+	};
+
+} // namespace fasstv
@@ -0,0 +1,62 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <libfasstv/SSTV.hpp>
+
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	// Works out the mode from the lines themselves, for when the VIS never made it.
+	// Autocorrelation of the sync pulses on the frequency track says which line periods are there,
+	// then folding the track over each mode's loop and lining it up with its syncs and porches says which mode it is,
+	// and where its loops start. Only needs a few lines to be sure.
+	class SSTVLineDetector {
+	public:
+		struct Result {
+			SSTV::Mode* mode = nullptr;
+			double loop_start_smp = 0.0; // first loop to start inside what was looked at
+			double loop_smp = 0.0; // how long every loop is
+			float error_hz = 0.f; // mean distance from the syncs and porches the mode should have
+		};
+
+		SSTVLineDetector() = default;
+
+		// only_mode to just confirm (and line up) one mode, nullptr to consider all of them
+		SSTVLineDetector(int samplerate, SSTV::Mode* only_mode = nullptr);
+
+		// freq is the frequency track, freq[0] being at start_smp. true if a mode was picked
+		bool Detect(std::span<const float> freq, int start_smp, Result& result) const;
+
+		// the most track Detect ever looks at, enough for the longest loop to repeat
+		int GetWindowSamples() const { return window_samples; }
+
+	private:
+		// a stretch of a loop that's always at the same frequency, syncs, porches and separators
+		struct Segment {
+			float start_ms;
+			float length_ms;
+			float freq;
+		};
+
+		struct Template {
+			SSTV::Mode* mode;
+			float loop_ms;
+			float sync_period_ms; // a loop can have more than one line, and so more than one sync
+			std::vector<Segment> segments;
+		};
+
+		void AddTemplate(SSTV::Mode* mode);
+
+		float SyncCorrelation(const std::vector<float>& sync, float period_bins) const;
+		bool MatchTemplate(const std::vector<float>& bins, const Template& tmpl, float& error_hz, int& phase_bin) const;
+
+		int samplerate = 0;
+		int min_samples = 0;
+		int window_samples = 0;
+		std::vector<Template> templates;
+	};
+
+} // namespace fasstv
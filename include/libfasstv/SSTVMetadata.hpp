@@ -4,32 +4,55 @@
 
 #include <libfasstv/SSTV.hpp>
 
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 namespace fasstv {
 
 	class SSTVMetadata {
 	public:
+		struct InstructionLength {
+			float length_ms;
+			int count;
+		};
+
 		struct PerModeMetadata {
 			SSTV::Mode* mode{};
 			float length_ms; // total length of mode
 			float loop_length_ms;
 			float scan_length_total_ms;
+			float transmission_length_ms; // length with the VOX/VIS header and footer
+			float pixels_per_second;
+			std::vector<InstructionLength> instruction_lengths; // every instruction length in a transmission, for exact sample counts
+		};
+
+		struct ModeConstraints {
+			int min_width = 0;
+			int min_lines = 0;
+			bool require_color = false;
 		};
 
 		static SSTV::Mode* mode_longest;
 		static SSTV::Mode* mode_shortest;
 
 		static void BuildMetadata();
+		static void AddModeMetadata(SSTV::Mode* mode); // for modes made after BuildMetadata (parametric)
 		static PerModeMetadata* GetModeMetadata(SSTV::Mode* mode);
 
+		static SSTV::Mode* SelectModeForAirtime(float budget_ms, const ModeConstraints& constraints);
+		static std::uint32_t GetLengthInSamples(SSTV::Mode* mode, int samplerate);
+
 	private:
 		static float mode_longest_ms;
 		static float mode_shortest_ms;
 
 		static void ProcessMetadata(SSTV::Mode* mode);
 
-		static std::vector<PerModeMetadata> per_mode_metadata;
+		// deque, as modes can be added after the fact (parametric modes) and we hand out pointers
+		static std::deque<PerModeMetadata> per_mode_metadata;
+		static std::mutex metadata_mutex; // decoders can make parametric modes from any thread
 	};
 
 } // namespace fasstv
@@ -0,0 +1,44 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	// Brings audio from whatever rate it was recorded at to the rate the decoder runs at.
+	// Polyphase windowed sinc, only as sharp as the SSTV band needs, so it stays short even at 96kHz.
+	// The rates don't have to divide, every output sample lands exactly where it should.
+	class SSTVResampler {
+	public:
+		static constexpr float PASSBAND_HZ = 2700.f; // top of the SSTV band, with some room for the filter to roll off
+		static constexpr int MAX_PHASES = 256; // past this, outputs snap to the nearest 1/256th of an input sample
+		static constexpr int LANES = 8; // taps are padded to this, so the dot product vectorises
+
+		SSTVResampler() = default;
+		SSTVResampler(int in_samplerate, int out_samplerate);
+
+		// appends the resampled audio to out
+		void Process(std::span<const float> in, std::vector<float>& out);
+
+		bool IsPassthrough() const { return in_samplerate == out_samplerate; }
+
+		// how many output samples late everything comes out
+		int GetDelaySamples() const { return delay_samples; }
+
+	private:
+		int in_samplerate = 0;
+		int out_samplerate = 0;
+
+		int taps = 0;
+		int phases = 0;
+		std::vector<float> coeffs; // taps per phase, oldest sample first
+		int delay_samples = 0;
+
+		std::vector<float> buffer; // the last taps-1 input samples, then whatever's being processed
+		int next_smp = 0; // newest sample in buffer the next output needs
+		int next_frac = 0; // how far past it the next output is, in 1/out_samplerate of an input sample
+	};
+
+} // namespace fasstv
@@ -0,0 +1,72 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <libfasstv/SSTV.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	class ThreadPool;
+
+	// Pulls every transmission out of a long recording, then decodes them all at once on a thread pool.
+	class SSTVScanner {
+	public:
+		static constexpr std::int16_t SYNC_MISSING = INT16_MIN;
+
+		struct Transmission {
+			std::int64_t start_smp {};  // start of the VIS leader
+			std::int64_t length_smp {}; // how long the mode (and its band header, if it's partial) says it goes for, from start_smp
+			std::uint8_t vis_code {};
+			SSTV::Mode* mode {};      // null if the VIS isn't one we know
+
+			// how far each sync pulse landed from where the mode says it should be, in samples.
+			// SYNC_MISSING for ones we couldn't hear
+			std::vector<std::int16_t> sync_offsets {};
+			float skew_ppm {};        // how much faster (+) or slower (-) than nominal the lines came in
+		};
+
+		struct DecodedImage {
+			Transmission transmission {};
+			SSTV::Mode* mode {};
+			std::vector<std::uint8_t> pixels {}; // RGBA8888, mode->width * mode->lines
+		};
+
+		// fills samples with up to count samples of the recording from first_smp on, fewer at the end of it.
+		// DecodeTransmissions calls it from several threads at once
+		using SampleReader = std::function<void(std::int64_t first_smp, size_t count, std::vector<float>& samples)>;
+
+		static std::vector<Transmission> FindTransmissions(std::span<const float> samples, int samplerate);
+		static std::vector<DecodedImage> DecodeTransmissions(std::span<const float> samples, int samplerate, const std::vector<Transmission>& transmissions, int threads = 0);
+
+		// same again, for recordings that aren't in memory as float. they're only ever read a window or a transmission at a time
+		static std::vector<Transmission> FindTransmissions(const SampleReader& reader, std::int64_t sample_count, int samplerate);
+		static std::vector<DecodedImage> DecodeTransmissions(const SampleReader& reader, int samplerate, const std::vector<Transmission>& transmissions, int threads = 0);
+
+		// the stretch of the recording DecodeTransmission wants to see, clamped to the start but not the end
+		static void GetDecodeRange(const Transmission& transmission, int samplerate, std::int64_t& from_smp, std::int64_t& to_smp);
+
+		// decodes one transmission out of samples covering (at least) its decode range, which start at samples_start_smp.
+		// its lines are spread over pool, if there is one
+		static DecodedImage DecodeTransmission(std::span<const float> samples, std::int64_t samples_start_smp, int samplerate, const Transmission& transmission, ThreadPool* pool = nullptr);
+
+		// lines each sync pulse up against the mode's timing, filling sync_offsets and skew_ppm.
+		// samples start at samples_start_smp, like DecodeTransmission's
+		static void MeasureSync(std::span<const float> samples, std::int64_t samples_start_smp, int samplerate, Transmission& transmission);
+
+		// reads the VIS code following a leader starting at start_smp, false if parity doesn't check out
+		static bool ReadVIS(std::span<const float> samples, int samplerate, std::int64_t start_smp, std::uint8_t& vis_code);
+
+		// reads the parameters a parametric VIS is followed by, false if parity doesn't check out
+		static bool ReadParametricHeader(std::span<const float> samples, int samplerate, std::int64_t start_smp, std::uint8_t vis_code, SSTV::ParametricModeParams& params);
+
+		// reads the loop bands a partial transmission of mode puts after its header. false, with no bands,
+		// for a whole transmission or a band header that doesn't check out, which the decoder reads as lines too
+		static bool ReadBandHeader(std::span<const float> samples, int samplerate, std::int64_t start_smp, const SSTV::Mode* mode, std::vector<SSTV::LineBand>& loop_bands);
+	};
+
+} // namespace fasstv
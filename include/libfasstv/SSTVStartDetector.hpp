@@ -0,0 +1,76 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	// Finds where transmissions start by looking for the VIS leader, break, leader and start bit.
+	// Runs a couple of Goertzel filters over short blocks instead of demodulating every sample,
+	// then lines the break up to the exact sample with the raw audio it keeps around.
+	class SSTVStartDetector {
+	public:
+		SSTVStartDetector() = default;
+		explicit SSTVStartDetector(int samplerate);
+
+		void PushSamples(std::span<const float> samples);
+
+		// start of each VIS leader found so far, in samples since the first push.
+		// 64 bit, as a long recording or a day of listening runs past what an int holds
+		const std::vector<std::int64_t>& GetStarts() const { return starts; }
+
+		// blocks since from_smp that were mostly the break frequency. every line's sync is at it too,
+		// so a transmission keeps these coming, VIS or not
+		int CountSyncBlocksSince(std::int64_t from_smp) const;
+
+		int GetBlockSize() const { return block_size; }
+		std::int64_t GetSamplesPushed() const { return samples_pushed; }
+
+		// raw samples from from_smp up to now, as far back as we still have them
+		std::span<const float> GetHistory(std::int64_t from_smp) const;
+		std::int64_t GetHistoryStart() const { return history_start_smp; }
+
+	private:
+		float GoertzelPower(const float* smp, int count, float coeff) const;
+		float BlockDominance(const float* smp) const;
+		float ScoreAt(std::int64_t break_block) const;
+		float SegmentMean(std::int64_t first_block, int count) const;
+		void ScanBlocks();
+		void PushWindow(std::span<const float> samples);
+		std::int64_t RefineBreak(std::int64_t coarse_smp) const;
+
+		int samplerate = 0;
+		int block_size = 0; // samples per block of the decimated track
+		int break_samples = 0;
+		int leader_samples = 0;
+
+		int break_blocks = 0;
+		int leader_blocks = 0;
+		int bit_blocks = 0;
+
+		float coeff_leader = 0.f;
+		float coeff_break = 0.f;
+
+		std::int64_t samples_pushed = 0;
+
+		std::vector<float> history;
+		std::int64_t history_start_smp = 0;
+
+		// leader vs break dominance per block, -1 (all break) to 1 (all leader)
+		std::vector<float> dominance;
+		std::vector<double> dominance_sum; // prefix sums, so any segment is O(1)
+		std::int64_t dominance_start_block = 0;
+		std::int64_t next_block_to_score = 0;
+
+		std::int64_t best_block = -1;
+		float best_score = 0.f;
+		std::int64_t suppress_until_block = 0;
+
+		std::vector<std::int64_t> starts;
+		std::vector<std::int64_t> sync_blocks; // where the last few of them started
+	};
+
+} // namespace fasstv
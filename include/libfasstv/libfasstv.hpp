@@ -5,4 +5,11 @@
 #include <libfasstv/SSTV.hpp>
 #include <libfasstv/SSTVMetadata.hpp>
 #include <libfasstv/SSTVEncode.hpp>
-#include <libfasstv/SSTVDecode.hpp>
\ No newline at end of file
+#include <libfasstv/SSTVDecode.hpp>
+#include <libfasstv/SSTVEncodeCache.hpp>
+#include <libfasstv/SSTVStartDetector.hpp>
+#include <libfasstv/SSTVLineDetector.hpp>
+#include <libfasstv/SSTVScanner.hpp>
+#include <libfasstv/SSTVIndex.hpp>
+#include <libfasstv/SSTVDemodulator.hpp>
+#include <libfasstv/SSTVResampler.hpp>
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <span>
 #include <vector>
 
 extern "C" {
@@ -12,10 +13,10 @@ extern "C" {
 
 namespace fasstv {
 
-	bool SamplesToWAV(std::vector<float>& samples, int samplerate, std::ofstream& file);
-	bool SamplesToBIN(std::vector<float>& samples, std::ofstream& file);
+	bool SamplesToWAV(std::span<const float> samples, int samplerate, std::ofstream& file);
+	bool SamplesToBIN(std::span<const float> samples, std::ofstream& file);
 
-	bool SamplesToAVCodec(std::vector<float>& samples, int samplerate, std::ofstream& file, AVCodecID format = AV_CODEC_ID_MP3, int bit_rate = 320000);
+	bool SamplesToAVCodec(std::span<const float> samples, int samplerate, std::ofstream& file, AVCodecID format = AV_CODEC_ID_MP3, int bit_rate = 320000);
 
 	void PixelsToQOI(std::uint8_t* pixels, int width, int height, std::ofstream& file);
 
@@ -0,0 +1,35 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fasstv {
+
+	// SHA-256, for keys that have to tell apart things nobody checks by hand
+	class Hasher256 {
+	public:
+		using Digest = std::array<std::uint8_t, 32>;
+
+		void Add(const void* data, size_t size);
+
+		template <typename T>
+		void Add(const T& value) {
+			Add(&value, sizeof(T));
+		}
+
+		// pads and finishes the hash, nothing can be added after
+		Digest Finish();
+
+	private:
+		void ProcessBlock(const std::uint8_t* block);
+
+		std::uint32_t state[8] { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+		std::uint8_t buffer[64] {};
+		size_t buffered = 0;
+		std::uint64_t total_bytes = 0;
+	};
+
+} // namespace fasstv
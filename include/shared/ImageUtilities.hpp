@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <vector>
 
 extern "C" {
 #include <libswscale/swscale.h>
@@ -17,4 +18,7 @@ namespace fasstv {
 	SDL_Surface* LoadImage(std::filesystem::path inputPath);
 	SDL_Surface* RescaleImage(SDL_Surface* surface, int width, int height, int flags = SWS_BICUBIC);
 
+	// converts to YUV420P (BT.601 studio range, same as the YRYBY scans send) in one buffer, with planes and strides pointing into it
+	bool ConvertToYUV420P(SDL_Surface* surface, std::vector<std::uint8_t>& buffer, const std::uint8_t* planes[3], int strides[3]);
+
 } // namespace fasstv
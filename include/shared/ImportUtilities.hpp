@@ -0,0 +1,103 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+
+namespace fasstv {
+
+	struct WAVFormat {
+		int samplerate {};
+		int channels {};
+		int bytes_per_sample {};
+		bool is_float {};
+
+		size_t data_offset {}; // from the start of the file
+		size_t data_size {};
+
+		size_t GetFrameSize() const { return bytes_per_sample * channels; }
+		size_t GetFrameCount() const { return GetFrameSize() != 0 ? data_size / GetFrameSize() : 0; }
+	};
+
+	// finds the format and data chunk of a WAV file in memory
+	bool ParseWAV(std::span<const std::uint8_t> bytes, WAVFormat& format);
+
+	// PCM (8/16/24/32 bit) or float WAV, mixed down to mono
+	bool SamplesFromWAV(std::ifstream& file, std::vector<float>& samples, int& samplerate);
+
+	// A WAV file mapped into memory, so frames can be read from anywhere without loading the rest.
+	// 8/16/24/32 bit and float, mono and stereo have their own conversion loops that vectorise
+	class MappedWAV {
+	public:
+		MappedWAV() = default;
+		~MappedWAV();
+
+		MappedWAV(const MappedWAV&) = delete;
+		MappedWAV& operator=(const MappedWAV&) = delete;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		const WAVFormat& GetFormat() const { return format; }
+		std::span<const std::uint8_t> GetBytes() const { return { data, size }; }
+
+		// frames [first, first + count) mixed down to mono, cut short at the end of the data
+		void ReadFrames(size_t first, size_t count, std::vector<float>& samples) const;
+
+		// the data itself, for mono float/16 bit that's lined up to read in place. empty otherwise
+		std::span<const float> GetFloatSamples() const;
+		std::span<const std::int16_t> GetInt16Samples() const;
+
+		// about to be read front to back, so read ahead (it's random access otherwise)
+		void AdviseSequential() const;
+
+		// done with every frame before this one, they don't need to stay in memory
+		void ReleaseFramesBefore(size_t frame) const;
+
+	private:
+		std::uint8_t* data = nullptr;
+		size_t size = 0;
+		WAVFormat format {};
+	};
+
+	// Any audio file libavformat can read, decoded a frame at a time and mixed down to mono.
+	// Only the frame being handed out is ever in memory, however long the file is
+	class AVAudioReader {
+	public:
+		AVAudioReader() = default;
+		~AVAudioReader();
+
+		AVAudioReader(const AVAudioReader&) = delete;
+		AVAudioReader& operator=(const AVAudioReader&) = delete;
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		int GetSampleRate() const { return samplerate; }
+		float GetDurationSeconds() const { return duration_seconds; } // 0 if the container doesn't say
+
+		// appends the next decoded frame to samples, false once there's nothing left
+		bool ReadSamples(std::vector<float>& samples);
+
+	private:
+		AVFormatContext* format_ctx = nullptr;
+		AVCodecContext* codec_ctx = nullptr;
+		AVPacket* packet = nullptr;
+		AVFrame* frame = nullptr;
+		int stream_index = -1;
+		bool draining = false;
+
+		int samplerate = 0;
+		float duration_seconds = 0.f;
+	};
+
+} // namespace fasstv
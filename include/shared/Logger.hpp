@@ -5,6 +5,7 @@
 #include <chrono>
 #include <cstdint>
 #include <format>
+#include <mutex>
 #include <vector>
 
 namespace fasstv {
@@ -95,6 +96,7 @@ namespace fasstv {
 #endif
 		};
 		std::vector<Sink*> sinks;
+		std::mutex sinkMutex; // keeps messages from different threads from interleaving
 	};
 
 	template <class... Args>
@@ -0,0 +1,65 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fasstv {
+
+	// Keeps a partially decoded image written out every so many lines or seconds, for anything watching the file.
+	// Rows are handed over as the decoder finishes them (already converted, so nothing's converted twice),
+	// and only rows that are new since the last write get copied across to the writer's buffer.
+	// Encoding and writing happen on a thread of its own, and if that's still busy a write is just put off,
+	// so whoever's adding lines never waits on the disk.
+	class ProgressiveImageWriter {
+	public:
+		// 0 to not write on that count
+		ProgressiveImageWriter(int every_lines, float every_seconds);
+		~ProgressiveImageWriter();
+
+		ProgressiveImageWriter(const ProgressiveImageWriter&) = delete;
+		ProgressiveImageWriter& operator=(const ProgressiveImageWriter&) = delete;
+
+		// starts a new image, RGBA8888
+		void Begin(const std::filesystem::path& path, int width, int lines);
+
+		// a finished row of the current image
+		void AddLine(int line, const std::uint8_t* pixels);
+
+		// waits for any write in flight, then stays quiet until the next Begin, so the final image can go where the partial ones were
+		void End();
+
+	private:
+		void Publish();
+		void WriterLoop();
+
+		int every_lines = 0;
+		std::chrono::steady_clock::duration every {};
+
+		// only touched by whoever's adding lines
+		std::vector<std::uint8_t> front {};
+		int width = 0, lines = 0;
+		bool active = false;
+		int lines_since_publish = 0;
+		std::chrono::steady_clock::time_point last_publish {};
+		int dirty_first = 0, dirty_end = 0; // rows in front that back doesn't have yet
+
+		// owned by the writer while a write's pending
+		std::vector<std::uint8_t> back {};
+		std::filesystem::path path {};
+
+		std::thread writer;
+		std::mutex mutex;
+		std::condition_variable write_requested;
+		std::condition_variable write_finished;
+		bool write_pending = false;
+		bool stopping = false;
+	};
+
+} // namespace fasstv
@@ -0,0 +1,74 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace fasstv {
+
+	// One thread pushes, one thread pops, nobody ever waits on a lock.
+	// Made for handing audio from a device callback to a worker, so when it's full the newest samples are the ones dropped.
+	template <typename T>
+	class RingBuffer {
+	public:
+		// rounded up to a power of two, so wrapping is just a mask
+		explicit RingBuffer(size_t min_capacity) {
+			size_t capacity = 1;
+			while (capacity < min_capacity)
+				capacity <<= 1;
+
+			buffer.resize(capacity);
+			mask = capacity - 1;
+		}
+
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+
+		// producer only. returns how many fit
+		size_t Push(std::span<const T> items) {
+			const size_t head_now = head.load(std::memory_order_relaxed);
+			const size_t tail_now = tail.load(std::memory_order_acquire);
+
+			const size_t count = std::min(items.size(), buffer.size() - (head_now - tail_now));
+			const size_t first = std::min(count, buffer.size() - (head_now & mask));
+
+			std::copy_n(items.begin(), first, buffer.begin() + (head_now & mask));
+			std::copy_n(items.begin() + first, count - first, buffer.begin());
+
+			head.store(head_now + count, std::memory_order_release);
+			return count;
+		}
+
+		// consumer only. returns how many were read into out
+		size_t Pop(std::span<T> out) {
+			const size_t tail_now = tail.load(std::memory_order_relaxed);
+			const size_t head_now = head.load(std::memory_order_acquire);
+
+			const size_t count = std::min(out.size(), head_now - tail_now);
+			const size_t first = std::min(count, buffer.size() - (tail_now & mask));
+
+			std::copy_n(buffer.begin() + (tail_now & mask), first, out.begin());
+			std::copy_n(buffer.begin(), count - first, out.begin() + first);
+
+			tail.store(tail_now + count, std::memory_order_release);
+			return count;
+		}
+
+		// only a snapshot, either side can have moved by the time it's used
+		size_t GetAvailable() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+		size_t GetCapacity() const { return buffer.size(); }
+
+	private:
+		std::vector<T> buffer;
+		size_t mask = 0;
+
+		// on their own cache lines, so the two threads don't keep stealing them off each other
+		alignas(64) std::atomic<size_t> head { 0 }; // only written by the producer
+		alignas(64) std::atomic<size_t> tail { 0 }; // only written by the consumer
+	};
+
+} // namespace fasstv
@@ -0,0 +1,46 @@
+// Created by block on 2026-10-18.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace fasstv {
+
+	class ThreadPool {
+	public:
+		explicit ThreadPool(int threads = 0); // 0 for one per core
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void Submit(std::function<void()> job);
+
+		// blocks until every submitted job has finished
+		void Wait();
+
+		// runs job(i) for every i in [0, count), with the calling thread pitching in.
+		// only waits on its own work, so it's fine to call from inside one of this pool's jobs
+		void ParallelFor(int count, const std::function<void(int)>& job);
+
+		int GetThreadCount() const { return workers.size(); }
+
+	private:
+		void WorkerLoop();
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> jobs;
+
+		std::mutex mutex;
+		std::condition_variable job_available;
+		std::condition_variable jobs_finished;
+		int jobs_running = 0;
+		bool stopping = false;
+	};
+
+} // namespace fasstv
@@ -4,6 +4,8 @@
 
 #include <argparse/argparse.hpp>
 
+#include <sstream>
+
 // https://stackoverflow.com/a/4119881
 bool ichar_equals(char a, char b) {
 	return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
@@ -13,6 +15,36 @@ namespace fasstv::cli {
 
 	OptionVariables Options::options {};
 
+	// WIDTHxLINES:LAYOUT:DWELL, ie 640x480:yuv420:100
+	SSTV::Mode* ParseParametricMode(const std::string& arg) {
+		SSTV::ParametricModeParams params {};
+		char layout[16] = {};
+		unsigned int width = 0, lines = 0;
+
+		if (std::sscanf(arg.c_str(), "%ux%u:%15[^:]:%f", &width, &lines, layout, &params.pixel_dwell_us) != 4) {
+			LogError("Couldn't parse parametric mode \"{}\", expected WIDTHxLINES:LAYOUT:DWELL", arg);
+			return nullptr;
+		}
+
+		// too big is too big, don't let it wrap around into something that fits
+		params.width = std::min(width, 0xFFFFu);
+		params.lines = std::min(lines, 0xFFFFu);
+
+		std::string_view layoutArg = layout;
+		if (std::ranges::equal(layoutArg, std::string_view("rgb"), ichar_equals))
+			params.layout = SSTV::ParametricLayout::RGB;
+		else if (std::ranges::equal(layoutArg, std::string_view("yuv420"), ichar_equals))
+			params.layout = SSTV::ParametricLayout::YCrCb420;
+		else if (std::ranges::equal(layoutArg, std::string_view("yuv422"), ichar_equals))
+			params.layout = SSTV::ParametricLayout::YCrCb422;
+		else {
+			LogError("Unknown parametric layout \"{}\" (try rgb, yuv420 or yuv422)", layoutArg);
+			return nullptr;
+		}
+
+		return SSTV::CreateParametricMode(params);
+	}
+
 	int Options::ParseArgs(int argc, char** argv) {
 		argparse::ArgumentParser program("fasstv-cli", "", argparse::default_arguments::help);
 
@@ -30,6 +62,8 @@ namespace fasstv::cli {
 			  .help("Path to the output audio file.");
 			encode_command.add_argument("-m", "--mode")
 			  .help("Specifies SSTV mode by name or VIS code.");
+			encode_command.add_argument("--parametric")
+			  .help("Builds a parametric mode from WIDTHxLINES:LAYOUT:DWELL, where LAYOUT is rgb, yuv420 or yuv422 and DWELL is microseconds per pixel. Overrides --mode.");
 			encode_command.add_argument("-r", "--samplerate").store_into(options.encode.samplerate)
 			  .help("Sampling rate of the signal.");
 			encode_command.add_argument("-v", "--volume").store_into(options.volume)
@@ -42,20 +76,54 @@ namespace fasstv::cli {
 			  .help("If specified, plays audio through default speakers.");
 			encode_command.add_argument("-n", "--noise-strength").store_into(options.encode.noise_strength)
 			  .help("Strength of random noise to apply to the signal.");
+			encode_command.add_argument("--planar-yuv").flag().store_into(options.encode.planar_yuv)
+			  .help("If specified, Robot and PD modes read Y/R-Y/B-Y straight from a YUV420P copy of the image, the way video frames come in.");
+			encode_command.add_argument("--lines")
+			  .help("Only sends these lines of the mode, as a partial transmission. Comma separated FIRST-LAST ranges, ie 0-59,120-139.");
+			encode_command.add_argument("--airtime").store_into(options.encode.airtime_budget)
+			  .help("Picks the mode with the most pixels per second that fits in this many seconds. Ignored if --mode is given.");
+			encode_command.add_argument("--min-width").store_into(options.encode.airtime_constraints.min_width)
+			  .help("Minimum width of the mode picked by --airtime.");
+			encode_command.add_argument("--min-lines").store_into(options.encode.airtime_constraints.min_lines)
+			  .help("Minimum lines of the mode picked by --airtime.");
+			encode_command.add_argument("--color").flag().store_into(options.encode.airtime_constraints.require_color)
+			  .help("Only allow color modes to be picked by --airtime.");
+			encode_command.add_argument("--cache").store_into(options.encode.cache_path)
+			  .help("Directory to cache rendered transmissions in, reused when the same image and settings are encoded again.");
+			encode_command.add_argument("--cache-size").store_into(options.encode.cache_size)
+			  .help("Maximum size of the encode cache in MiB.");
 		}
 
 		argparse::ArgumentParser decode_command("decode", "", argparse::default_arguments::help);
 		decode_command.add_description("Decode an SSTV signal from a file or microphone.");
 		program.add_subparser(decode_command);
 		{
-			decode_command.add_argument("input").store_into(options.inputPath)
-			  .help("Path to the input audio file.");
+			decode_command.add_argument("input").store_into(options.inputPath).nargs(argparse::nargs_pattern::optional)
+			  .help("Path to the input audio file. (WAV, FLAC, MP3, OGG, anything FFmpeg reads) Not needed with --microphone.");
 			decode_command.add_argument("-o", "--output").store_into(options.outputPath)
-			  .help("Path to the output audio file.");
+			  .help("Path to the output image file. Defaults to the input path with .qoi on the end. With --microphone, each transmission is numbered after it, defaulting to live-000.qoi and on.");
 			decode_command.add_argument("-m", "--mode")
 			  .help("Specifies SSTV mode by name or VIS code.");
-			decode_command.add_argument("--microphone")
-			  .help("Specifies a microphone by (partial) device name.");
+			decode_command.add_argument("--parametric")
+			  .help("Builds a parametric mode from WIDTHxLINES:LAYOUT:DWELL, where LAYOUT is rgb, yuv420 or yuv422 and DWELL is microseconds per pixel. Overrides --mode.");
+			decode_command.add_argument("--microphone").store_into(options.decode.microphone)
+			  .help("Decodes live from a microphone, picked by (partial) device name or \"default\", until closed. For testing without one, SDL_AUDIO_DRIVER=disk reads the raw mono float file at SDL_AUDIO_DISK_INPUT_FILE instead.");
+			decode_command.add_argument("--preview").flag().store_into(options.decode.preview)
+			  .help("If specified with --microphone, shows lines in a window as they're decoded.");
+			decode_command.add_argument("--progress-lines").store_into(options.decode.progress_lines)
+			  .help("Writes the partially decoded image to the output every this many lines, for watching long modes come in.");
+			decode_command.add_argument("--progress-interval").store_into(options.decode.progress_seconds)
+			  .help("Writes the partially decoded image to the output every this many seconds. Can be used with --progress-lines.");
+			decode_command.add_argument("--from-start").flag().store_into(options.decode.from_start)
+			  .help("If specified, expects the transmission right at the start of the input instead of searching for it.");
+			decode_command.add_argument("--vis-only").flag().store_into(options.decode.vis_only)
+			  .help("If specified, only decodes transmissions with a readable VIS, instead of working the mode out from the lines when it's missing or garbled.");
+			decode_command.add_argument("--previous").store_into(options.decode.previous_image)
+			  .help("Image a partial transmission patches its lines into, instead of leaving the rest black. Needs --mode. With --microphone, the last image received is kept for the next one either way.");
+			decode_command.add_argument("-t", "--threads").store_into(options.decode.threads)
+			  .help("Number of threads to decode lines with. Defaults to one per core.");
+			decode_command.add_argument("--demodulator")
+			  .help("Demodulator to turn audio into frequencies with. (cordic, zerocrossing, hilbert, goertzel) Defaults to cordic.");
 		}
 
 		argparse::ArgumentParser transcode_command("transcode", "", argparse::default_arguments::help);
@@ -68,6 +136,8 @@ namespace fasstv::cli {
 			  .help("Path to the output image file.");
 			transcode_command.add_argument("-m", "--mode")
 			  .help("Specifies SSTV mode by name or VIS code.");
+			transcode_command.add_argument("--parametric")
+			  .help("Builds a parametric mode from WIDTHxLINES:LAYOUT:DWELL, where LAYOUT is rgb, yuv420 or yuv422 and DWELL is microseconds per pixel. Overrides --mode.");
 			transcode_command.add_argument("--resize-mode").flag().store_into(options.transcode.resize_mode_to_image)
 			  .help("If specified, resizes the SSTV mode to the size of the input image.");
 			transcode_command.add_argument("-r", "--samplerate").store_into(options.encode.samplerate)
@@ -82,6 +152,42 @@ namespace fasstv::cli {
 			  .help("If specified, plays audio through default speakers.");
 			transcode_command.add_argument("-n", "--noise-strength").store_into(options.encode.noise_strength)
 			  .help("Strength of random noise to apply to the signal.");
+			transcode_command.add_argument("--planar-yuv").flag().store_into(options.encode.planar_yuv)
+			  .help("If specified, Robot and PD modes read Y/R-Y/B-Y straight from a YUV420P copy of the image, the way video frames come in.");
+			transcode_command.add_argument("--from-start").flag().store_into(options.decode.from_start)
+			  .help("If specified, expects the transmission right at the start of the input instead of searching for it.");
+			transcode_command.add_argument("--vis-only").flag().store_into(options.decode.vis_only)
+			  .help("If specified, only decodes transmissions with a readable VIS, instead of working the mode out from the lines when it's missing or garbled.");
+			transcode_command.add_argument("-t", "--threads").store_into(options.decode.threads)
+			  .help("Number of threads to decode lines with. Defaults to one per core.");
+			transcode_command.add_argument("--demodulator")
+			  .help("Demodulator to turn audio into frequencies with. (cordic, zerocrossing, hilbert, goertzel) Defaults to cordic.");
+			transcode_command.add_argument("--lines")
+			  .help("Only sends these lines of the mode, as a partial transmission. Comma separated FIRST-LAST ranges, ie 0-59,120-139.");
+			transcode_command.add_argument("--airtime").store_into(options.encode.airtime_budget)
+			  .help("Picks the mode with the most pixels per second that fits in this many seconds. Ignored if --mode is given.");
+			transcode_command.add_argument("--min-width").store_into(options.encode.airtime_constraints.min_width)
+			  .help("Minimum width of the mode picked by --airtime.");
+			transcode_command.add_argument("--min-lines").store_into(options.encode.airtime_constraints.min_lines)
+			  .help("Minimum lines of the mode picked by --airtime.");
+			transcode_command.add_argument("--color").flag().store_into(options.encode.airtime_constraints.require_color)
+			  .help("Only allow color modes to be picked by --airtime.");
+		}
+
+		argparse::ArgumentParser scan_command("scan", "", argparse::default_arguments::help);
+		scan_command.add_description("Find and decode every SSTV transmission in a long recording.");
+		program.add_subparser(scan_command);
+		{
+			scan_command.add_argument("input").store_into(options.inputPath)
+			  .help("Path to the input WAV file.");
+			scan_command.add_argument("-o", "--output").store_into(options.outputPath)
+			  .help("Path to the output images, numbered per transmission. Defaults to next to the input.");
+			scan_command.add_argument("-t", "--threads").store_into(options.scan.threads)
+			  .help("Number of threads to decode with. Defaults to one per core.");
+			scan_command.add_argument("-e", "--entry").store_into(options.scan.entry)
+			  .help("Only decode this transmission (counting from 0), seeking straight to it if the recording has been indexed.");
+			scan_command.add_argument("--rescan").flag().store_into(options.scan.rescan)
+			  .help("Scan the recording again, even if it has an up to date index.");
 		}
 
 		try {
@@ -102,9 +208,17 @@ namespace fasstv::cli {
 		else if (program.is_subcommand_used(transcode_command)) {
 			options.fasstv_mode = FASSTVMode::Transcode;
 		}
+		else if (program.is_subcommand_used(scan_command)) {
+			options.fasstv_mode = FASSTVMode::Scan;
+		}
 
-		if (options.fasstv_mode == FASSTVMode::Encode || options.fasstv_mode == FASSTVMode::Transcode) {
-			argparse::ArgumentParser* cmd = options.fasstv_mode == FASSTVMode::Encode ? &encode_command : &transcode_command;
+		// scanning reads modes out of the recording
+		if (options.fasstv_mode != FASSTVMode::Invalid && options.fasstv_mode != FASSTVMode::Scan) {
+			argparse::ArgumentParser* cmd = &decode_command;
+			if (options.fasstv_mode == FASSTVMode::Encode)
+				cmd = &encode_command;
+			else if (options.fasstv_mode == FASSTVMode::Transcode)
+				cmd = &transcode_command;
 
 			if (cmd->is_used("--mode")) {
 				std::string modeArg = cmd->get<std::string>("--mode");
@@ -116,6 +230,34 @@ namespace fasstv::cli {
 				}
 			}
 
+			if (cmd->is_used("--parametric")) {
+				options.mode = ParseParametricMode(cmd->get<std::string>("--parametric"));
+				if (options.mode == nullptr)
+					std::exit(1);
+			}
+		}
+
+		if (options.fasstv_mode == FASSTVMode::Decode && options.inputPath.empty() && options.decode.microphone.empty()) {
+			std::cerr << "Decoding needs an input file or --microphone" << std::endl;
+			std::cerr << decode_command;
+			std::exit(1);
+		}
+
+		if (options.fasstv_mode == FASSTVMode::Decode || options.fasstv_mode == FASSTVMode::Transcode) {
+			argparse::ArgumentParser* cmd = options.fasstv_mode == FASSTVMode::Decode ? &decode_command : &transcode_command;
+
+			if (cmd->is_used("--demodulator")) {
+				std::string demodulatorArg = cmd->get<std::string>("--demodulator");
+				if (!SSTVDemodulator::GetTypeByName(demodulatorArg, options.decode.demodulator)) {
+					std::cerr << "Unknown demodulator \"" << demodulatorArg << "\"" << std::endl;
+					std::exit(1);
+				}
+			}
+		}
+
+		if (options.fasstv_mode == FASSTVMode::Encode || options.fasstv_mode == FASSTVMode::Transcode) {
+			argparse::ArgumentParser* cmd = options.fasstv_mode == FASSTVMode::Encode ? &encode_command : &transcode_command;
+
 			if (cmd->is_used("--scalemethod")) {
 				std::string scaleMethodArg = cmd->get<std::string>("--scalemethod");
 				if (!scaleMethodArg.empty()) {
@@ -126,6 +268,33 @@ namespace fasstv::cli {
 				}
 			}
 
+			if (cmd->is_used("--lines")) {
+				std::string linesArg = cmd->get<std::string>("--lines");
+				std::stringstream ss(linesArg);
+				std::string range;
+
+				while (std::getline(ss, range, ',')) {
+					unsigned int first = 0, last = 0;
+					int read = std::sscanf(range.c_str(), "%u-%u", &first, &last);
+					if (read == 1)
+						last = first;
+					else if (read != 2 || last < first) {
+						std::cerr << "Couldn't parse line range \"" << range << "\"" << std::endl;
+						std::exit(1);
+					}
+
+					options.encode.line_bands.push_back({static_cast<std::uint16_t>(first), static_cast<std::uint16_t>(last - first + 1)});
+				}
+			}
+
+			if (options.mode == nullptr && options.encode.airtime_budget > 0.f) {
+				options.mode = SSTVMetadata::SelectModeForAirtime(options.encode.airtime_budget * 1000.f, options.encode.airtime_constraints);
+				if (options.mode != nullptr)
+					LogInfo("Picked mode {} for an airtime of {}s", options.mode->name, options.encode.airtime_budget);
+				else
+					LogWarning("No mode fits in an airtime of {}s", options.encode.airtime_budget);
+			}
+
 			// fallback to Robot 36 if no mode set
 			if (options.mode == nullptr)
 				options.mode = SSTV::GetMode("Robot 36");
@@ -150,12 +319,29 @@ namespace fasstv::cli {
 		LogInfo("    Stretch image? {}", options.encode.image_stretch);
 		LogInfo("    Resize method: {}\n", options.encode.image_resize_method);
 		LogInfo("    Noise strength: {}\n", options.encode.noise_strength);
+		LogInfo("    Planar YUV? {}", options.encode.planar_yuv);
+		LogInfo("    Line bands: {}", options.encode.line_bands.size());
+		LogInfo("    Airtime budget: {}s", options.encode.airtime_budget);
+		LogInfo("    Airtime constraints: {}x{}, color? {}", options.encode.airtime_constraints.min_width, options.encode.airtime_constraints.min_lines, options.encode.airtime_constraints.require_color);
+		LogInfo("    Cache: {} ({}MiB)\n", options.encode.cache_path.string(), options.encode.cache_size);
 
 		LogInfo("Decode options:");
-		LogInfo("    Camera name: {}\n", options.decode.microphone);
+		LogInfo("    Microphone name: {}", options.decode.microphone);
+		LogInfo("    Preview? {}", options.decode.preview);
+		LogInfo("    Progressive output: every {} lines, {}s", options.decode.progress_lines, options.decode.progress_seconds);
+		LogInfo("    From start? {}", options.decode.from_start);
+		LogInfo("    VIS only? {}", options.decode.vis_only);
+		LogInfo("    Previous image: {}", options.decode.previous_image.string());
+		LogInfo("    Threads: {}", options.decode.threads);
+		LogInfo("    Demodulator: {}\n", SSTVDemodulator::GetTypeName(options.decode.demodulator));
 
 		LogInfo("Transcode options:");
-		LogInfo("    Resize mode to image? {}", options.transcode.resize_mode_to_image);
+		LogInfo("    Resize mode to image? {}\n", options.transcode.resize_mode_to_image);
+
+		LogInfo("Scan options:");
+		LogInfo("    Threads: {}", options.scan.threads);
+		LogInfo("    Entry: {}", options.scan.entry);
+		LogInfo("    Rescan? {}", options.scan.rescan);
 	}
 
 } // namespace fasstv::cli
\ No newline at end of file
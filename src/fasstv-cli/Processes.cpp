@@ -2,6 +2,13 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <thread>
+
 #include <libfasstv/libfasstv.hpp>
 
 #include <fasstv-cli/Options.hpp>
@@ -9,8 +16,10 @@
 
 #include <shared/ExportUtilities.hpp>
 #include <shared/ImageUtilities.hpp>
+#include <shared/ImportUtilities.hpp>
 #include <shared/Logger.hpp>
 #include <shared/Rect.hpp>
+#include <shared/ThreadPool.hpp>
 
 namespace fasstv::cli {
 
@@ -23,11 +32,43 @@ namespace fasstv::cli {
 		if (outputPath.empty())
 			return;
 
-		// one-shot
+		// noisy or per-scan renders aren't reproducible, so they never touch the cache
+		std::unique_ptr<SSTVEncodeCache> cache {};
+		if (!Options::options.encode.cache_path.empty() && !Options::options.encode.separate_scans && Options::options.encode.noise_strength <= 0.f && !Options::options.encode.planar_yuv)
+			cache = std::make_unique<SSTVEncodeCache>(Options::options.encode.cache_path, static_cast<std::uint64_t>(Options::options.encode.cache_size) * 1024 * 1024);
+
+		SSTVEncodeCache::Key key {};
+		SSTVEncodeCache::MappedSamples cached {};
 		std::vector<float> samples;
-		SSTVEncode::The().RunAllInstructions(samples, {0, 0, surf_out->w, surf_out->h});
-		for (float& smp : samples)
-			smp *= Options::options.volume;
+		std::span<const float> output {};
+
+		if (cache) {
+			SSTVEncodeCache::EncodeParams params {
+				SSTVEncode::The().GetMode(),
+				Options::options.encode.samplerate,
+				Options::options.volume,
+				Options::options.encode.noise_strength,
+				Options::options.encode.line_bands
+			};
+
+			key = SSTVEncodeCache::MakeKey(static_cast<const std::uint8_t*>(surf_out->pixels), surf_out->w, surf_out->h, surf_out->pitch, params);
+			if (cache->Lookup(key, cached)) {
+				LogInfo("Using cached samples {}", key.ToString());
+				output = cached.GetSamples();
+			}
+		}
+
+		if (output.empty()) {
+			// one-shot
+			SSTVEncode::The().RunAllInstructions(samples, {0, 0, surf_out->w, surf_out->h});
+			for (float& smp : samples)
+				smp *= Options::options.volume;
+
+			if (cache)
+				cache->Store(key, samples);
+
+			output = samples;
+		}
 
 		// for automatic file naming
 		if (!outputPath.has_extension()) {
@@ -38,24 +79,42 @@ namespace fasstv::cli {
 		std::ofstream file(outputPath.string(), std::ios::binary);
 
 		if (outputPath.extension() == ".mp3")
-			SamplesToAVCodec(samples, Options::options.encode.samplerate, file);
+			SamplesToAVCodec(output, Options::options.encode.samplerate, file);
 		else
-			SamplesToWAV(samples, Options::options.encode.samplerate, file);
+			SamplesToWAV(output, Options::options.encode.samplerate, file);
 
 		file.close();
 		samples.clear();
+
+		if (cache) {
+			const SSTVEncodeCache::Stats& stats = cache->GetStats();
+			LogDebug("Encode cache: {} hits, {} misses, {} stores, {} evictions", stats.hits, stats.misses, stats.stores, stats.evictions);
+		}
 	}
 
 	void Processes::OutputImage(std::vector<float>& samples, std::filesystem::path& outputPath) {
 		if (outputPath.empty())
 			return;
 
+		// lines get decoded side by side once their timing's known
+		ThreadPool pool(Options::options.decode.threads);
+
+		SSTVDecode::The().SetStartSearch(!Options::options.decode.from_start);
+		SSTVDecode::The().SetLineDetection(!Options::options.decode.vis_only);
+		SSTVDecode::The().SetDemodulator(Options::options.decode.demodulator);
+		SSTVDecode::The().SetThreadPool(pool.GetThreadCount() > 1 ? &pool : nullptr);
 		SSTVDecode::The().DecodeSamples(samples, Options::options.encode.samplerate, Options::options.mode, true);
+		SSTVDecode::The().SetThreadPool(nullptr);
+
+		SaveDecodedImage(outputPath);
+	}
+
+	bool Processes::SaveDecodedImage(std::filesystem::path& outputPath) {
 		SSTV::Mode* mode = SSTVDecode::The().GetMode();
 
 		if (mode == nullptr) {
 			LogError("Decode failed, cannot export");
-			return;
+			return false;
 		}
 
 		// for automatic file naming
@@ -63,6 +122,10 @@ namespace fasstv::cli {
 		outputPath.replace_extension(".qoi");
 		//}
 
+		DecodeLineQuality quality = SSTVDecode::The().GetImageQuality();
+		if (quality.decoded)
+			LogInfo("Quality {:.0f}%: syncs {:.2f}ms off, tones {:.0f}Hz off, SNR {:.1f}dB, {:.1f}% clipped", quality.score * 100.f, quality.sync_error_ms, quality.tone_error_hz, quality.snr_db, quality.clipped * 100.f);
+
 		LogInfo("Saving {}...", outputPath.c_str());
 		std::ofstream file(outputPath.string(), std::ios::binary);
 
@@ -70,6 +133,29 @@ namespace fasstv::cli {
 			PixelsToQOI(SSTVDecode::The().GetPixels(nullptr), mode->width, mode->lines, file);
 
 		file.close();
+		return true;
+	}
+
+	void Processes::LogTranscodeError() {
+		SSTV::Mode* mode = SSTVDecode::The().GetMode();
+		std::uint8_t* decoded = SSTVDecode::The().GetPixels(nullptr);
+
+		// only comparable when the image filled the whole mode
+		if (mode == nullptr || decoded == nullptr || surf_out == nullptr || surf_out->w != mode->width || surf_out->h != mode->lines)
+			return;
+
+		double error = 0.0;
+		for (int y = 0; y < mode->lines; y++) {
+			const std::uint8_t* row = static_cast<const std::uint8_t*>(surf_out->pixels) + (y * surf_out->pitch);
+			for (int x = 0; x < mode->width; x++) {
+				for (int c = 0; c < 3; c++)
+					error += std::abs(row[(x * 4) + c] - decoded[(((y * mode->width) + x) * 4) + c]);
+			}
+		}
+		error /= mode->width * mode->lines * 3.0;
+
+		SSTVMetadata::PerModeMetadata* modemeta = SSTVMetadata::GetModeMetadata(mode);
+		LogInfo("{}: {} pixels/s, mean absolute error of {:.2f}", mode->name, modemeta ? modemeta->pixels_per_second : 0.f, error);
 	}
 
 	int Processes::Audio_Setup() {
@@ -130,6 +216,7 @@ namespace fasstv::cli {
 		}
 
 		// build instructions
+		sstvenc.SetLineBands(Options::options.encode.line_bands);
 		sstvenc.SetMode(mode);
 
 		Rect letterbox = Rect::CreateLetterbox(mode->width, mode->lines, { 0, 0, surf_orig->w, surf_orig->h });
@@ -146,11 +233,65 @@ namespace fasstv::cli {
 		sstvenc.SetLetterbox(Rect::CreateLetterbox(mode->width, mode->lines, { 0, 0, surf_out->w, surf_out->h }));
 		sstvenc.SetLetterboxLines(false);
 		sstvenc.SetPixelProvider(&GetSampleFromSurface);
+		sstvenc.SetPlanarYUVSource(nullptr);
 		sstvenc.SetNoiseStrength(Options::options.encode.noise_strength);
 
+		if (Options::options.encode.planar_yuv) {
+			if (mode->scan_type != SSTV::YRYBY)
+				LogWarning("{} isn't a YUV mode, sending RGB pixels", mode->name);
+			else if (!Encode_SetupPlanarYUV())
+				LogWarning("Planar YUV source didn't work out, sending RGB pixels");
+		}
+
+		SSTVMetadata::PerModeMetadata* modemeta = SSTVMetadata::GetModeMetadata(mode);
+		if (modemeta != nullptr)
+			LogInfo("{} transmits for {}s, {} samples at {}Hz", mode->name, modemeta->transmission_length_ms / 1000.f, SSTVMetadata::GetLengthInSamples(mode, Options::options.encode.samplerate), Options::options.encode.samplerate);
+
 		return EXIT_SUCCESS;
 	}
 
+	bool Processes::Encode_SetupPlanarYUV() {
+		SSTVEncode& sstvenc = SSTVEncode::The();
+
+		if (!ConvertToYUV420P(surf_out, yuv_buffer, yuv_frame.planes, yuv_frame.strides))
+			return false;
+
+		yuv_frame.width = surf_out->w;
+		yuv_frame.height = surf_out->h;
+		yuv_frame.chroma_shift_x = 1;
+		yuv_frame.chroma_shift_y = 1;
+
+		// check it against the RGB path pixel by pixel. luma should only be off by rounding,
+		// chroma is a 2x2 average so it's only reported
+		SSTV::Instruction scan {};
+		float luma_max_hz = 0.f;
+		double chroma_sum_hz = 0.0;
+
+		for (int y = 0; y < surf_out->h; y++) {
+			for (int x = 0; x < surf_out->w; x++) {
+				for (int pass = 0; pass < 3; pass++) {
+					scan.pitch = pass;
+					float rgb = SSTVEncode::ScanYRYBY(&scan, x, y, GetSampleFromSurface(x, y));
+					float yuv = SSTVEncode::ScanYRYBYPlanar(&scan, &yuv_frame, x, y);
+
+					if (pass == 0)
+						luma_max_hz = std::max(luma_max_hz, std::abs(rgb - yuv));
+					else
+						chroma_sum_hz += std::abs(rgb - yuv);
+				}
+			}
+		}
+
+		float chroma_mean_hz = chroma_sum_hz / (2.0 * surf_out->w * surf_out->h);
+		LogInfo("Planar YUV against RGB: luma within {:.1f}Hz, chroma {:.1f}Hz off on average", luma_max_hz, chroma_mean_hz);
+
+		if (luma_max_hz > yuv_max_luma_error_hz)
+			return false;
+
+		sstvenc.SetPlanarYUVSource(&yuv_frame);
+		return true;
+	}
+
 	int Processes::ProcessEncode() {
 		if (Options::options.play) {
 			if (!SDL_Init(SDL_INIT_AUDIO)) {
@@ -255,11 +396,478 @@ namespace fasstv::cli {
 	}
 
 	int Processes::ProcessDecode() {
-		LogInfo("Decoding from files not yet implemented");
+		if (!Options::options.decode.microphone.empty())
+			return Decode_Microphone();
+
+#ifdef FASSTV_DEBUG
+		if (!SDL_Init(SDL_INIT_VIDEO)) {
+			LogError("Couldn't initialize SDL: {}", SDL_GetError());
+			return SDL_APP_FAILURE;
+		}
+#endif
+
+		// plain WAVs get mapped and read in place, everything else (or a WAV we can't parse) goes through FFmpeg
+		MappedWAV wav;
+		AVAudioReader reader;
+
+		std::string extension = Options::options.inputPath.extension().string();
+		bool mapped = std::ranges::equal(extension, std::string_view(".wav"), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; }) && wav.Open(Options::options.inputPath);
+		if (!mapped && !reader.Open(Options::options.inputPath))
+			return EXIT_FAILURE;
+
+		if (Options::options.outputPath.empty()) {
+			// original filename + ".qoi"
+			Options::options.outputPath = Options::options.inputPath;
+			Options::options.outputPath.replace_filename(Options::options.inputPath.filename().string() + ".qoi");
+		}
+
+		const int samplerate = mapped ? wav.GetFormat().samplerate : reader.GetSampleRate();
+		const float durationSeconds = mapped ? wav.GetFormat().GetFrameCount() / (float)samplerate : reader.GetDurationSeconds();
+		LogInfo("Decoding {} ({}s at {}Hz)...", Options::options.inputPath.string(), durationSeconds, samplerate);
+
+		if (!Decode_LoadPreviousImage())
+			return EXIT_FAILURE;
+
+		auto timeStart = std::chrono::steady_clock::now();
+
+		// lines get decoded side by side once their timing's known
+		ThreadPool pool(Options::options.decode.threads);
+
+		Decode_SetupProgressiveOutput();
+
+		SSTVDecode& sstvdec = SSTVDecode::The();
+		sstvdec.SetStartSearch(!Options::options.decode.from_start);
+		sstvdec.SetLineDetection(!Options::options.decode.vis_only);
+		sstvdec.SetDemodulator(Options::options.decode.demodulator);
+		sstvdec.SetThreadPool(pool.GetThreadCount() > 1 ? &pool : nullptr);
+		sstvdec.SetScanlineCallback(progress_writer ? &Decode_OnScanline : nullptr);
+		sstvdec.StartStream(samplerate, Options::options.mode, Options::options.mode != nullptr);
+
+		size_t samplesRead = mapped ? Decode_PushMappedWAV(wav) : Decode_PushAVAudio(reader);
+
+		sstvdec.FinishStream();
+		sstvdec.SetScanlineCallback(nullptr);
+		sstvdec.SetThreadPool(nullptr);
+
+		// the whole image goes where the partial ones were
+		if (progress_writer) {
+			progress_writer->End();
+			progress_writer.reset();
+		}
+
+		float lengthSeconds = samplesRead / (float)samplerate;
+		float elapsedSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - timeStart).count();
+		LogInfo("Read {}s of audio in {}s ({}x realtime)", lengthSeconds, elapsedSeconds, lengthSeconds / elapsedSeconds);
+
+		bool saved = SaveDecodedImage(Options::options.outputPath);
+
+#ifdef FASSTV_DEBUG
+		while (sdl_run && sstvdec.debug_DebugWindowIsOpen()) {
+			while (SDL_PollEvent(&event)) {
+				if (event.type == SDL_EVENT_QUIT)
+					sdl_run = false;
+
+				sstvdec.debug_DebugWindowPump(&event);
+			}
+
+			sstvdec.debug_DebugWindowRender();
+		}
+
+		SDL_Quit();
+#endif
+
+		return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	size_t Processes::Decode_PushMappedWAV(const MappedWAV& wav) {
+		SSTVDecode& sstvdec = SSTVDecode::The();
+		const size_t frames = wav.GetFormat().GetFrameCount();
+
+		wav.AdviseSequential();
+
+		// mono float and 16 bit are pushed straight out of the mapping, the decoder only converts a window at a time.
+		// pages behind what's been pushed are let go as we go, so a huge recording doesn't pile up in memory
+		std::span<const float> floatSamples = wav.GetFloatSamples();
+		std::span<const std::int16_t> int16Samples = wav.GetInt16Samples();
+
+		std::vector<float> block;
+		size_t pos = 0;
+
+		while (pos < frames && !sstvdec.IsDone()) {
+			size_t count = 0;
+
+			if (!floatSamples.empty()) {
+				count = std::min(mapped_block_size, frames - pos);
+				sstvdec.PushSamples(floatSamples.subspan(pos, count));
+			}
+			else if (!int16Samples.empty()) {
+				count = std::min(mapped_block_size, frames - pos);
+				sstvdec.PushSamples(int16Samples.subspan(pos, count));
+			}
+			else {
+				wav.ReadFrames(pos, decode_block_size, block);
+				count = block.size();
+				sstvdec.PushSamples(block);
+			}
+
+			pos += count;
+			wav.ReleaseFramesBefore(pos);
+		}
+
+		return pos;
+	}
+
+	size_t Processes::Decode_PushAVAudio(AVAudioReader& reader) {
+		SSTVDecode& sstvdec = SSTVDecode::The();
+
+		// frames straight out of the codec are small, so a few get gathered up before each push.
+		// nothing more than a block is ever held, however long the recording
+		std::vector<float> block;
+		block.reserve(decode_block_size * 2);
+		size_t samplesRead = 0;
+
+		while (!sstvdec.IsDone()) {
+			bool more = reader.ReadSamples(block);
+
+			if (block.size() >= decode_block_size || (!more && !block.empty())) {
+				samplesRead += block.size();
+				sstvdec.PushSamples(block);
+				block.clear();
+			}
+
+			if (!more)
+				break;
+		}
+
+		return samplesRead;
+	}
+
+	std::filesystem::path Processes::Decode_GetImagePath() const {
+		std::filesystem::path imagePath = Options::options.outputPath;
+
+		// live, it's one image per transmission, numbered in the order they were heard
+		if (!Options::options.decode.microphone.empty())
+			imagePath.replace_filename(std::format("{}-{:03}.qoi", Options::options.outputPath.stem().string(), live_images));
+		else
+			imagePath.replace_extension(".qoi");
+
+		return imagePath;
+	}
+
+	void Processes::Decode_SetupProgressiveOutput() {
+		emitted_lines = 0;
+
+		const int everyLines = Options::options.decode.progress_lines;
+		const float everySeconds = Options::options.decode.progress_seconds;
+		if (everyLines > 0 || everySeconds > 0.f)
+			progress_writer = std::make_unique<ProgressiveImageWriter>(everyLines, everySeconds);
+	}
+
+	bool Processes::Decode_LoadPreviousImage() {
+		if (Options::options.decode.previous_image.empty())
+			return true;
+
+		SSTV::Mode* mode = Options::options.mode;
+		if (mode == nullptr) {
+			LogError("--previous needs --mode, to know what size the image should be");
+			return false;
+		}
+
+		SDL_Surface* surfPrevious = LoadImage(Options::options.decode.previous_image);
+		if (surfPrevious == nullptr)
+			return false;
+
+		// it may well be what we wrote last time, but scale it in case it isn't
+		SDL_Surface* surfScaled = RescaleImage(surfPrevious, mode->width, mode->lines);
+		SDL_DestroySurface(surfPrevious);
+
+		bool loaded = SSTVDecode::The().LoadRetainedImage(mode, static_cast<const std::uint8_t*>(surfScaled->pixels), surfScaled->w, surfScaled->h, surfScaled->pitch);
+		SDL_DestroySurface(surfScaled);
+
+		if (loaded)
+			LogInfo("Patching partial transmissions into {}", Options::options.decode.previous_image.string());
+
+		return loaded;
+	}
+
+	SDL_AudioDeviceID Processes::Decode_FindRecordingDevice(const std::string& name) {
+		if (std::ranges::equal(name, std::string_view("default"), [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; }))
+			return SDL_AUDIO_DEVICE_DEFAULT_RECORDING;
+
+		int count = 0;
+		SDL_AudioDeviceID* devices = SDL_GetAudioRecordingDevices(&count);
+		if (devices == nullptr) {
+			LogError("Couldn't list microphones: {}", SDL_GetError());
+			return 0;
+		}
+
+		// first one with the name anywhere in it, ignoring case
+		auto ichar_equals = [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); };
+		SDL_AudioDeviceID found = 0;
+		for (int i = 0; i < count && found == 0; i++) {
+			std::string_view deviceName = SDL_GetAudioDeviceName(devices[i]);
+			if (!std::ranges::search(deviceName, name, ichar_equals).empty())
+				found = devices[i];
+		}
 
+		if (found == 0) {
+			LogError("No microphone matching \"{}\", there's:", name);
+			for (int i = 0; i < count; i++)
+				LogError("    {}", SDL_GetAudioDeviceName(devices[i]));
+		}
+
+		SDL_free(devices);
+		return found;
+	}
+
+	int Processes::Decode_Microphone() {
+		SDL_InitFlags flags = SDL_INIT_AUDIO;
+#ifdef FASSTV_DEBUG
+		flags |= SDL_INIT_VIDEO;
+#endif
+		if (Options::options.decode.preview)
+			flags |= SDL_INIT_VIDEO;
+
+		// audio brings events along, so ctrl+c comes through as a quit
+		if (!SDL_Init(flags)) {
+			LogError("Couldn't initialize SDL: {}", SDL_GetError());
+			return SDL_APP_FAILURE;
+		}
+
+		// a partial transmission patches into whatever came in before it
+		SSTVDecode::The().SetRetainImage(true);
+		if (!Decode_LoadPreviousImage()) {
+			SDL_Quit();
+			return EXIT_FAILURE;
+		}
+
+		SDL_AudioDeviceID device = Decode_FindRecordingDevice(Options::options.decode.microphone);
+		if (device == 0) {
+			SDL_Quit();
+			return EXIT_FAILURE;
+		}
+
+		// record at whatever the device runs at, the decoder resamples better than a generic converter would
+		SDL_AudioSpec spec {};
+		if (!SDL_GetAudioDeviceFormat(device, &spec, nullptr)) {
+			LogError("Couldn't get the microphone's format: {}", SDL_GetError());
+			SDL_Quit();
+			return EXIT_FAILURE;
+		}
+
+		spec.format = SDL_AUDIO_F32;
+		spec.channels = 1;
+		live_samplerate = spec.freq;
+
+		recording_ring = std::make_unique<RingBuffer<float>>(static_cast<size_t>(live_samplerate * live_ring_seconds));
+		recording_buffer.resize(live_block_size);
+
+		if (Options::options.outputPath.empty())
+			Options::options.outputPath = "live.qoi";
+
+		if (Options::options.decode.preview) {
+			if (!SDL_CreateWindowAndRenderer("fasstv", 640, 496, SDL_WINDOW_RESIZABLE, &preview_window, &preview_renderer)) {
+				LogError("Couldn't create the preview window: {}", SDL_GetError());
+				SDL_Quit();
+				return SDL_APP_FAILURE;
+			}
+		}
+
+		audio_stream = SDL_OpenAudioDeviceStream(device, &spec, &Decode_RecordingCallback, this);
+		if (!audio_stream) {
+			LogError("Couldn't open the microphone: {}", SDL_GetError());
+			SDL_Quit();
+			return SDL_APP_FAILURE;
+		}
+
+		LogInfo("Listening on {} at {}Hz...", SDL_GetAudioDeviceName(SDL_GetAudioStreamDevice(audio_stream)), live_samplerate);
+
+		// lines get decoded side by side once their timing's known
+		ThreadPool pool(Options::options.decode.threads);
+
+		Decode_SetupProgressiveOutput();
+
+		SSTVDecode& sstvdec = SSTVDecode::The();
+		sstvdec.SetStartSearch(!Options::options.decode.from_start);
+		sstvdec.SetLineDetection(!Options::options.decode.vis_only);
+		sstvdec.SetDemodulator(Options::options.decode.demodulator);
+		sstvdec.SetThreadPool(pool.GetThreadCount() > 1 ? &pool : nullptr);
+		sstvdec.SetScanlineCallback(&Decode_OnScanline);
+
+		sstvdec.StartStream(live_samplerate, Options::options.mode, Options::options.mode != nullptr);
+
+		live_run = true;
+		std::thread worker(&Processes::Decode_MicrophoneWorker, this);
+
+		if (!SDL_ResumeAudioStreamDevice(audio_stream)) {
+			LogError("Couldn't start recording: {}", SDL_GetError());
+			sdl_run = false;
+		}
+
+		while (sdl_run) {
+			while (SDL_PollEvent(&event)) {
+				if (event.type == SDL_EVENT_QUIT)
+					sdl_run = false;
+			}
+
+			if (preview_renderer != nullptr)
+				Decode_RenderPreview();
+
+			SDL_Delay(live_poll_ms);
+		}
+
+		// stop the audio first, so nothing's pushing while the worker finishes up whatever's left
+		SDL_DestroyAudioStream(audio_stream);
+		audio_stream = nullptr;
+
+		live_run = false;
+		worker.join();
+
+		sstvdec.SetScanlineCallback(nullptr);
+		sstvdec.SetThreadPool(nullptr);
+		progress_writer.reset();
+
+		if (preview_texture != nullptr)
+			SDL_DestroyTexture(preview_texture);
+		if (preview_renderer != nullptr)
+			SDL_DestroyRenderer(preview_renderer);
+		if (preview_window != nullptr)
+			SDL_DestroyWindow(preview_window);
+
+		SDL_Quit();
+
+		LogInfo("Saved {} transmission(s)", live_images);
 		return EXIT_SUCCESS;
 	}
 
+	void SDLCALL Processes::Decode_RecordingCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int /*total_amount*/) {
+		Processes* self = static_cast<Processes*>(userdata);
+
+		// this is SDL's audio thread, nothing in here can wait on the decoder.
+		// if the worker's that far behind, the newest audio is dropped rather than holding up the device
+		const int buffer_bytes = static_cast<int>(self->recording_buffer.size() * sizeof(float));
+		while (additional_amount > 0) {
+			int got = SDL_GetAudioStreamData(stream, self->recording_buffer.data(), std::min(additional_amount, buffer_bytes));
+			if (got <= 0)
+				break;
+
+			size_t count = got / sizeof(float);
+			size_t pushed = self->recording_ring->Push(std::span<const float>(self->recording_buffer).first(count));
+			if (pushed < count)
+				self->recording_dropped.fetch_add(count - pushed, std::memory_order_relaxed);
+
+			additional_amount -= got;
+		}
+	}
+
+	void Processes::Decode_MicrophoneWorker() {
+		SSTVDecode& sstvdec = SSTVDecode::The();
+		std::vector<float> block(live_block_size);
+		size_t reportedDropped = 0;
+
+		while (live_run) {
+			size_t count = recording_ring->Pop(block);
+			if (count == 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(live_idle_ms));
+				continue;
+			}
+
+			sstvdec.PushSamples(std::span<const float>(block).first(count));
+
+			size_t dropped = recording_dropped.load(std::memory_order_relaxed);
+			if (dropped != reportedDropped) {
+				LogWarning("Decoding isn't keeping up, {}s of audio dropped so far", dropped / (float)live_samplerate);
+				reportedDropped = dropped;
+			}
+
+			// straight back to listening for the next one
+			if (sstvdec.IsDone()) {
+				Decode_SaveLiveImage();
+				sstvdec.StartStream(live_samplerate, Options::options.mode, Options::options.mode != nullptr);
+			}
+		}
+
+		// whatever was still coming in when we were stopped
+		sstvdec.FinishStream();
+		Decode_SaveLiveImage();
+	}
+
+	void Processes::Decode_SaveLiveImage() {
+		// a bad VIS or parity ends the stream with nothing to show for it
+		if (emitted_lines == 0)
+			return;
+
+		if (progress_writer)
+			progress_writer->End();
+
+		std::filesystem::path imagePath = Decode_GetImagePath();
+		if (SaveDecodedImage(imagePath))
+			live_images++;
+
+		emitted_lines = 0;
+	}
+
+	void Processes::Decode_OnScanline(int line, const std::uint8_t* pixels, int width) {
+		// on the worker thread, from inside PushSamples
+		Processes& self = The();
+		const int lines = SSTVDecode::The().GetMode()->lines;
+
+		if (self.progress_writer) {
+			if (self.emitted_lines == 0)
+				self.progress_writer->Begin(self.Decode_GetImagePath(), width, lines);
+
+			self.progress_writer->AddLine(line, pixels);
+		}
+
+		self.emitted_lines++;
+
+		if (self.preview_window == nullptr)
+			return;
+
+		const size_t rowBytes = static_cast<size_t>(width) * SSTVDecode::NUM_CHANNELS;
+
+		std::lock_guard lock(self.preview_mutex);
+		if (self.preview_width != width || self.preview_lines != lines) {
+			self.preview_width = width;
+			self.preview_lines = lines;
+			self.preview_pixels.assign(rowBytes * lines, 0);
+		}
+
+		std::copy_n(pixels, rowBytes, &self.preview_pixels[line * rowBytes]);
+		self.preview_dirty = true;
+	}
+
+	void Processes::Decode_RenderPreview() {
+		{
+			std::lock_guard lock(preview_mutex);
+			if (preview_dirty) {
+				if (preview_texture == nullptr || preview_texture_width != preview_width || preview_texture_lines != preview_lines) {
+					if (preview_texture != nullptr)
+						SDL_DestroyTexture(preview_texture);
+
+					preview_texture = SDL_CreateTexture(preview_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, preview_width, preview_lines);
+					preview_texture_width = preview_width;
+					preview_texture_lines = preview_lines;
+
+					// the decoder doesn't promise anything about alpha
+					if (preview_texture != nullptr)
+						SDL_SetTextureBlendMode(preview_texture, SDL_BLENDMODE_NONE);
+				}
+
+				if (preview_texture != nullptr)
+					SDL_UpdateTexture(preview_texture, nullptr, preview_pixels.data(), preview_width * SSTVDecode::NUM_CHANNELS);
+
+				preview_dirty = false;
+			}
+		}
+
+		SDL_SetRenderDrawColor(preview_renderer, 0, 0, 0, 255);
+		SDL_RenderClear(preview_renderer);
+		if (preview_texture != nullptr)
+			SDL_RenderTexture(preview_renderer, preview_texture, nullptr, nullptr);
+		SDL_RenderPresent(preview_renderer);
+	}
+
 	int Processes::ProcessTranscode() {
 #ifdef FASSTV_DEBUG
 		if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -303,6 +911,8 @@ namespace fasstv::cli {
 		OutputImage(samples, Options::options.outputPath);
 		//OutputSamples(Options::options.outputPath);
 
+		LogTranscodeError();
+
 		if (Options::options.play)
 			// reset so we can play from the beginning
 			sstvenc.ResetInstructionProcessing();
@@ -357,4 +967,110 @@ namespace fasstv::cli {
 		return EXIT_SUCCESS;
 	}
 
+	void Processes::OutputScanImage(const SSTVScanner::DecodedImage& image, int index, int samplerate) {
+		if (image.mode == nullptr) {
+			LogWarning("Transmission {} didn't decode", index);
+			return;
+		}
+
+		// one image per transmission, numbered in the order they were heard
+		std::filesystem::path outputPath = Options::options.outputPath.empty() ? Options::options.inputPath : Options::options.outputPath;
+		std::filesystem::path imagePath = outputPath;
+		imagePath.replace_filename(std::format("{}-{:03}.qoi", outputPath.stem().string(), index));
+
+		LogInfo("Saving {} ({} at {}s)...", imagePath.c_str(), image.mode->name, image.transmission.start_smp / (float)samplerate);
+		std::ofstream imageFile(imagePath.string(), std::ios::binary);
+		PixelsToQOI(const_cast<std::uint8_t*>(image.pixels.data()), image.mode->width, image.mode->lines, imageFile);
+		imageFile.close();
+	}
+
+	int Processes::ProcessScan() {
+		MappedWAV wav;
+		if (!wav.Open(Options::options.inputPath))
+			return EXIT_FAILURE;
+
+		const WAVFormat& format = wav.GetFormat();
+		const int samplerate = format.samplerate;
+		float lengthSeconds = format.GetFrameCount() / (float)samplerate;
+
+		auto timeStart = std::chrono::steady_clock::now();
+
+		// an index only counts if it's for this exact recording
+		SSTVIndex index;
+		std::filesystem::path indexPath = SSTVIndex::GetSidecarPath(Options::options.inputPath);
+		SSTVIndex::RecordingHash hash = SSTVIndex::HashRecording(wav.GetBytes());
+
+		bool indexed = !Options::options.scan.rescan && index.Load(indexPath) && index.recording_hash == hash && index.samplerate == samplerate && index.sample_count == format.GetFrameCount();
+
+		// mono float is scanned in place, anything else is converted a window (or a transmission) at a time
+		std::span<const float> samples = wav.GetFloatSamples();
+		SSTVScanner::SampleReader reader = [&wav](std::int64_t first_smp, size_t count, std::vector<float>& out) {
+			wav.ReadFrames(first_smp, count, out);
+		};
+
+		if (indexed) {
+			LogInfo("Using index {}, {} transmission(s)", indexPath.string(), index.transmissions.size());
+		}
+		else {
+			LogInfo("Scanning {}s of audio at {}Hz...", lengthSeconds, samplerate);
+			wav.AdviseSequential();
+
+			index.recording_hash = hash;
+			index.samplerate = samplerate;
+			index.sample_count = format.GetFrameCount();
+			if (!samples.empty())
+				index.transmissions = SSTVScanner::FindTransmissions(samples, samplerate);
+			else
+				index.transmissions = SSTVScanner::FindTransmissions(reader, format.GetFrameCount(), samplerate);
+
+			if (index.Save(indexPath))
+				LogInfo("Saved index {}", indexPath.string());
+		}
+
+		for (size_t i = 0; i < index.transmissions.size(); i++) {
+			const SSTVScanner::Transmission& transmission = index.transmissions[i];
+			if (transmission.mode != nullptr)
+				LogInfo("{}: {} at {}s, {}ppm skew", i, transmission.mode->name, transmission.start_smp / (float)samplerate, transmission.skew_ppm);
+			else
+				LogInfo("{}: unknown VIS code {} at {}s", i, transmission.vis_code, transmission.start_smp / (float)samplerate);
+		}
+
+		int entry = Options::options.scan.entry;
+		if (entry >= static_cast<int>(index.transmissions.size())) {
+			LogError("There's no transmission {}, only {} were found", entry, index.transmissions.size());
+			return EXIT_FAILURE;
+		}
+
+		if (entry >= 0) {
+			// just the one, so only read what it covers
+			const SSTVScanner::Transmission& transmission = index.transmissions[entry];
+
+			std::int64_t from = 0, to = 0;
+			SSTVScanner::GetDecodeRange(transmission, samplerate, from, to);
+
+			std::vector<float> slice;
+			wav.ReadFrames(from, to - from, slice);
+
+			ThreadPool pool(Options::options.scan.threads);
+			SSTVScanner::DecodedImage image = SSTVScanner::DecodeTransmission(slice, from, samplerate, transmission, &pool);
+			OutputScanImage(image, entry, samplerate);
+		}
+		else {
+			wav.AdviseSequential();
+
+			std::vector<SSTVScanner::DecodedImage> images;
+			if (!samples.empty())
+				images = SSTVScanner::DecodeTransmissions(samples, samplerate, index.transmissions, Options::options.scan.threads);
+			else
+				images = SSTVScanner::DecodeTransmissions(reader, samplerate, index.transmissions, Options::options.scan.threads);
+			for (size_t i = 0; i < images.size(); i++)
+				OutputScanImage(images[i], i, samplerate);
+		}
+
+		float elapsedSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - timeStart).count();
+		LogInfo("Done in {}s ({}x realtime)", elapsedSeconds, lengthSeconds / elapsedSeconds);
+
+		return EXIT_SUCCESS;
+	}
+
 }
\ No newline at end of file
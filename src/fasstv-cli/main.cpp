@@ -17,6 +17,9 @@
 int main(int argc, char** argv) {
 	fasstv::LoggerAttachStdout();
 
+	// needed by the options for picking modes
+	fasstv::SSTVMetadata::BuildMetadata();
+
 	int ret = fasstv::cli::Options::ParseArgs(argc, argv);
 	if (ret != EXIT_SUCCESS)
 		return ret;
@@ -29,8 +32,6 @@ int main(int argc, char** argv) {
 	fasstv::cli::Options::PrintArgs();
 #endif
 
-	fasstv::SSTVMetadata::BuildMetadata();
-
 	switch (fasstv::cli::Options::options.fasstv_mode) {
 		case fasstv::cli::FASSTVMode::Encode:
 			ret = fasstv::cli::Processes::The().ProcessEncode();
@@ -41,6 +42,9 @@ int main(int argc, char** argv) {
 		case fasstv::cli::FASSTVMode::Transcode:
 			ret = fasstv::cli::Processes::The().ProcessTranscode();
 			break;
+		case fasstv::cli::FASSTVMode::Scan:
+			ret = fasstv::cli::Processes::The().ProcessScan();
+			break;
 		default:
 			fasstv::LogError("Invalid fasstv mode... how did you do that?");
 			break;
@@ -1,8 +1,10 @@
 // Created by block on 5/25/24.
 
 #include <libfasstv/SSTV.hpp>
+#include <libfasstv/SSTVMetadata.hpp>
 #include <shared/Logger.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
@@ -25,6 +27,14 @@ namespace fasstv {
 			return &mode;
 		}
 
+		std::lock_guard lock(SSTV::The().PARAMETRIC_MUTEX);
+		for (auto& mode : SSTV::The().PARAMETRIC_MODES) {
+			if (mode.name != name)
+				continue;
+
+			return &mode;
+		}
+
 		return nullptr;
 	}
 
@@ -36,25 +46,205 @@ namespace fasstv {
 			return &mode;
 		}
 
+		// parametric modes share their VIS with every other mode of the same layout, their header says which one it is
 		return nullptr;
 	}
 
-	void SSTV::CreateInstructions(std::vector<Instruction>& instructions, const Mode* mode, bool clear /*= true*/) {
+	SSTV::Mode* SSTV::CreateParametricMode(const ParametricModeParams& params) {
+		SSTV& sstv = SSTV::The();
+
+		if (params.width == 0 || params.lines == 0 || params.pixel_dwell_us <= 0.f) {
+			LogError("Parametric mode needs a size and a pixel dwell time");
+			return nullptr;
+		}
+
+		// it has to fit in the header to be sent at all
+		int dwell_steps = std::lround(params.pixel_dwell_us * PARAMETRIC_DWELL_STEPS_PER_US);
+		if (params.width >= (1 << PARAMETRIC_HEADER_SIZE_BITS) || params.lines >= (1 << PARAMETRIC_HEADER_SIZE_BITS) || dwell_steps <= 0 || dwell_steps >= (1 << PARAMETRIC_HEADER_DWELL_BITS)) {
+			LogError("Parametric mode {}x{} at {}us doesn't fit in its header (up to {}x{} at {}us)", params.width, params.lines, params.pixel_dwell_us,
+				(1 << PARAMETRIC_HEADER_SIZE_BITS) - 1, (1 << PARAMETRIC_HEADER_SIZE_BITS) - 1, ((1 << PARAMETRIC_HEADER_DWELL_BITS) - 1) / static_cast<float>(PARAMETRIC_DWELL_STEPS_PER_US));
+			return nullptr;
+		}
+
+		// the dwell goes out in steps, so snap to one here to get the same mode the other end will read
+		ParametricModeParams sent = params;
+		sent.pixel_dwell_us = dwell_steps / static_cast<float>(PARAMETRIC_DWELL_STEPS_PER_US);
+
+		std::lock_guard lock(sstv.PARAMETRIC_MUTEX);
+
+		// the same parameters always give the same mode
+		for (size_t i = 0; i < sstv.PARAMETRIC_MODE_PARAMS.size(); i++) {
+			if (sstv.PARAMETRIC_MODE_PARAMS[i] == sent)
+				return &sstv.PARAMETRIC_MODES[i];
+		}
+
+		Mode mode {};
+		mode.vis_code = PARAMETRIC_VIS_FIRST + static_cast<int>(sent.layout);
+		mode.width = sent.width;
+		mode.lines = sent.lines;
+
+		float scan_ms = (sent.width * sent.pixel_dwell_us) / 1000.f;
+		const char* layout_name = "";
+
+		switch (sent.layout) {
+			case ParametricLayout::RGB:
+				layout_name = "RGB";
+				mode.scan_type = ScanType::RGB;
+				mode.uses_extra_lines = false;
+				mode.timings = {5.0f, 1.5f, scan_ms}; // sync pulse, porch, color scan
+				mode.frequencies = {1200, 1500}; // sync pulse, porch
+				mode.instructions_looping = sstv.BLOCK_INSTRUCTIONS;
+				break;
+			case ParametricLayout::YCrCb420:
+				layout_name = "YCrCb420";
+				mode.scan_type = ScanType::YRYBY;
+				mode.uses_extra_lines = true;
+				mode.timings = {9.0f, 3.0f, scan_ms, 4.5f, 1.5f, scan_ms / 2.f}; // sync pulse, sync porch, Y scan, separator pulse, porch, R-Y/B-Y scan
+				mode.frequencies = {1200, 1500, 1900, 2300}; // sync pulse, sync porch/even separator pulse, porch, odd separator pulse
+				mode.instructions_looping = sstv.ROBOT_4_2_0_INSTRUCTIONS;
+				// lines are sent in pairs
+				mode.lines += mode.lines % 2;
+				break;
+			case ParametricLayout::YCrCb422:
+				layout_name = "YCrCb422";
+				mode.scan_type = ScanType::YRYBY;
+				mode.uses_extra_lines = false;
+				mode.timings = {9.0f, 3.0f, scan_ms, 4.5f, 1.5f, scan_ms / 2.f}; // sync pulse, sync porch, Y scan, separator pulse, porch, R-Y/B-Y scan
+				mode.frequencies = {1200, 1500, 1900, 2300}; // sync pulse, sync porch/even separator pulse, porch, odd separator pulse
+				mode.instructions_looping = sstv.ROBOT_4_2_2_INSTRUCTIONS;
+				break;
+			default:
+				LogError("Unknown parametric layout {}", static_cast<int>(sent.layout));
+				return nullptr;
+		}
+
+		mode.instruction_loop_start = 0;
+		mode.name = std::format("Parametric {}x{} {} {}us", mode.width, mode.lines, layout_name, sent.pixel_dwell_us);
+
+		LogDebug("Created {} as VIS code {}", mode.name, mode.vis_code);
+
+		sstv.PARAMETRIC_MODE_PARAMS.push_back(sent);
+		Mode* created = &sstv.PARAMETRIC_MODES.emplace_back(std::move(mode));
+
+		// done here rather than on first lookup, so looking metadata up never changes anything
+		SSTVMetadata::AddModeMetadata(created);
+		return created;
+	}
+
+	bool SSTV::GetParametricParams(const Mode* mode, ParametricModeParams& params) {
+		SSTV& sstv = SSTV::The();
+		if (mode == nullptr || !IsParametricVIS(mode->vis_code))
+			return false;
+
+		std::lock_guard lock(sstv.PARAMETRIC_MUTEX);
+		for (size_t i = 0; i < sstv.PARAMETRIC_MODES.size(); i++) {
+			if (&sstv.PARAMETRIC_MODES[i] != mode)
+				continue;
+
+			params = sstv.PARAMETRIC_MODE_PARAMS[i];
+			return true;
+		}
+
+		return false;
+	}
+
+	int SSTV::GetLinesPerLoop(const Mode* mode) {
+		// some modes (for example, Robot 36) can define multiple lines per instruction set
+		int lines_per_loop = 0;
+		for (size_t i = mode->instruction_loop_start; i < mode->instructions_looping.size(); i++) {
+			const Instruction& ins = mode->instructions_looping[i];
+			if (!(ins.flags & InstructionFlags::NewLine))
+				continue;
+			if (!mode->uses_extra_lines && ins.flags & InstructionFlags::ExtraLine)
+				continue;
+
+			lines_per_loop++;
+		}
+
+		return std::max(lines_per_loop, 1);
+	}
+
+	std::vector<SSTV::LineBand> SSTV::GetLoopBands(const Mode* mode, const std::vector<LineBand>& line_bands) {
+		std::vector<LineBand> loop_bands;
+
+		int lines_per_loop = GetLinesPerLoop(mode);
+		int loops = mode->lines / lines_per_loop;
+
+		if (loops >= (1 << BAND_HEADER_LOOP_BITS)) {
+			LogWarning("{} has too many lines for a partial transmission, sending all of it", mode->name);
+			return loop_bands;
+		}
+
+		// lines to loops, rounding outwards so every requested line gets sent
+		for (const LineBand& band : line_bands) {
+			int first = band.first / lines_per_loop;
+			int end = std::min((band.first + band.count + lines_per_loop - 1) / lines_per_loop, loops);
+			if (end > first)
+				loop_bands.push_back({static_cast<std::uint16_t>(first), static_cast<std::uint16_t>(end - first)});
+		}
+
+		std::sort(loop_bands.begin(), loop_bands.end(), [](const LineBand& a, const LineBand& b) { return a.first < b.first; });
+
+		// merge anything touching or overlapping
+		std::vector<LineBand> merged;
+		for (const LineBand& band : loop_bands) {
+			if (!merged.empty() && band.first <= merged.back().first + merged.back().count) {
+				int end = std::max(merged.back().first + merged.back().count, band.first + band.count);
+				merged.back().count = end - merged.back().first;
+			}
+			else {
+				merged.push_back(band);
+			}
+		}
+
+		// the header can only fit so many, fold the rest into the last one
+		if (merged.size() > BAND_HEADER_MAX_BANDS) {
+			LogWarning("Too many line bands ({}), merging the last {}", merged.size(), merged.size() - BAND_HEADER_MAX_BANDS + 1);
+			LineBand& last = merged[BAND_HEADER_MAX_BANDS - 1];
+			last.count = (merged.back().first + merged.back().count) - last.first;
+			merged.resize(BAND_HEADER_MAX_BANDS);
+		}
+
+		return merged;
+	}
+
+	bool SSTV::AreLoopBandsValid(const Mode* mode, const std::vector<LineBand>& loop_bands) {
+		if (mode == nullptr || loop_bands.empty() || loop_bands.size() > BAND_HEADER_MAX_BANDS)
+			return false;
+
+		// in order, apart and inside the mode, same as GetLoopBands leaves them
+		int loops = mode->lines / GetLinesPerLoop(mode);
+		int end = -1;
+		for (const LineBand& band : loop_bands) {
+			if (band.count == 0 || band.first <= end || band.first + band.count > loops)
+				return false;
+
+			end = band.first + band.count;
+		}
+
+		return true;
+	}
+
+	void SSTV::CreateInstructions(std::vector<Instruction>& instructions, const Mode* mode, bool clear /*= true*/, const std::vector<LineBand>* loop_bands /*= nullptr*/) {
 		if (clear)
 			instructions.clear();
 
+		bool partial = loop_bands != nullptr && !loop_bands->empty();
+
 		CreateVOXHeader(instructions);
 		SSTV::CreateVISHeader(instructions, mode->vis_code);
 
+		ParametricModeParams params {};
+		if (GetParametricParams(mode, params))
+			CreateParametricHeader(instructions, params);
+
+		if (partial)
+			CreateBandHeader(instructions, *loop_bands);
+
 		// some modes (for example, Robot 36) can define multiple lines per instruction set
 		int instruction_divisor = 1;
-		if (mode->uses_extra_lines) {
-			instruction_divisor = 0;
-			for (const Instruction& ins : mode->instructions_looping) {
-				if (ins.flags & InstructionFlags::NewLine)
-					instruction_divisor++;
-			}
-		}
+		if (mode->uses_extra_lines)
+			instruction_divisor = GetLinesPerLoop(mode);
 
 		int lines = mode->lines / instruction_divisor;
 
@@ -65,7 +255,20 @@ namespace fasstv {
 				instructions.push_back(mode->instructions_looping[i]);
 		}
 
+		int next_loop = 0; // the loop we'd send next if nothing was skipped
+
 		for (int i = 0; i < lines; i++) {
+			if (partial) {
+				bool in_band = std::any_of(loop_bands->begin(), loop_bands->end(), [i](const LineBand& band) { return i >= band.first && i < band.first + band.count; });
+				if (!in_band)
+					continue;
+
+				// let the line counters catch up on what we didn't send
+				if (i > next_loop)
+					instructions.push_back({"Skip", 0, static_cast<float>((i - next_loop) * GetLinesPerLoop(mode)), Skip});
+				next_loop = i + 1;
+			}
+
 			for (size_t j = mode->instruction_loop_start; j < mode->instructions_looping.size(); j++) {
 				// found an extra line, but we don't use them - skip
 				SSTV::Instruction ins = mode->instructions_looping[j];
@@ -119,6 +322,40 @@ namespace fasstv {
 		instructions.push_back({"VIS stop",   The().VIS_LENGTHS_MS[1],  The().VIS_FREQS[0], VIS});
 	}
 
+	void PushHeaderBits(std::vector<SSTV::Instruction>& instructions, const char* name, int value, int bits, bool& parity) {
+		for (int i = 0; i < bits; i++) {
+			bool bit = value & (1 << i);
+			instructions.push_back({std::string(name) + " bit " + std::to_string(i), SSTV::The().VIS_LENGTHS_MS[1], SSTV::The().VIS_BIT_FREQS[bit], SSTV::VIS});
+
+			if (bit)
+				parity = !parity;
+		}
+	}
+
+	void SSTV::CreateParametricHeader(std::vector<Instruction>& instructions, const ParametricModeParams& params) {
+		bool parity = false;
+
+		PushHeaderBits(instructions, "Parametric width", params.width, PARAMETRIC_HEADER_SIZE_BITS, parity);
+		PushHeaderBits(instructions, "Parametric lines", params.lines, PARAMETRIC_HEADER_SIZE_BITS, parity);
+		PushHeaderBits(instructions, "Parametric dwell", std::lround(params.pixel_dwell_us * PARAMETRIC_DWELL_STEPS_PER_US), PARAMETRIC_HEADER_DWELL_BITS, parity);
+		instructions.push_back({"Parametric parity", The().VIS_LENGTHS_MS[1], The().VIS_BIT_FREQS[parity], VIS});
+		instructions.push_back({"Parametric stop",   The().VIS_LENGTHS_MS[1], The().VIS_FREQS[0], VIS});
+	}
+
+	void SSTV::CreateBandHeader(std::vector<Instruction>& instructions, const std::vector<LineBand>& loop_bands) {
+		int band_count = std::min<int>(loop_bands.size(), BAND_HEADER_MAX_BANDS);
+		bool parity = false;
+
+		instructions.push_back({"Band marker", The().VIS_LENGTHS_MS[1] * BAND_HEADER_MARKER_BITS, BAND_HEADER_MARKER_FREQ, VIS});
+		PushHeaderBits(instructions, "Band count", band_count, BAND_HEADER_COUNT_BITS, parity);
+		for (int i = 0; i < band_count; i++) {
+			PushHeaderBits(instructions, "Band first", loop_bands[i].first, BAND_HEADER_LOOP_BITS, parity);
+			PushHeaderBits(instructions, "Band loops", loop_bands[i].count, BAND_HEADER_LOOP_BITS, parity);
+		}
+		instructions.push_back({"Band parity", The().VIS_LENGTHS_MS[1], The().VIS_BIT_FREQS[parity], VIS});
+		instructions.push_back({"Band stop",   The().VIS_LENGTHS_MS[1], The().VIS_FREQS[0], VIS});
+	}
+
 	void SSTV::CreateFooter(std::vector<Instruction>& instructions) {
 		// I've got no clue if this is right. I could barely find information
 		// on the VOX tones, and none about this. If I understand it right,
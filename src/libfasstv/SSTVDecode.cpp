@@ -5,81 +5,14 @@
 #include <cstring>
 #include <libfasstv/libfasstv.hpp>
 #include <shared/Logger.hpp>
+#include <shared/ThreadPool.hpp>
 
-#include "../../third_party/PicoSSTV/cordic.h"
-#include "../../third_party/PicoSSTV/half_band_filter2.h"
 #include "fasstv-cli/Options.hpp"
 
 #ifdef FASSTV_DEBUG
 #include <SDL3/SDL.h>
 #endif
 
-// Majority of frequency tracking code by Jon Dawson
-// https://github.com/dawsonjon/PicoSSTV
-
-half_band_filter2 ssb_filter;
-uint8_t ssb_phase = 0;
-int16_t last_phase = 0;
-
-int16_t rolling_freq_from_sample(int16_t audio, int samplerate)
-{
-	// shift frequency by +FS/4
-	//       __|__
-	//   ___/  |  \___
-	//         |
-	//   <-----+----->
-
-	//        | ____
-	//  ______|/    \
-	//        |
-	//  <-----+----->
-
-	// filter -Fs/4 to +Fs/4
-
-	//        | __
-	//  ______|/  \__
-	//        |
-	//  <-----+----->
-
-	ssb_phase = (ssb_phase + 1) & 3u;
-	audio = audio >> 1;
-
-	const int16_t audio_i[4] = {audio, 0, (int16_t)-audio, 0};
-	const int16_t audio_q[4] = {0, (int16_t)-audio, 0, audio};
-	int16_t ii = audio_i[ssb_phase];
-	int16_t qq = audio_q[ssb_phase];
-	ssb_filter.filter(ii, qq);
-
-	// shift frequency by -FS/4
-	//         | __
-	//   ______|/  \__
-	//         |
-	//   <-----+----->
-
-	//     __ |
-	//  __/  \|______
-	//        |
-	//  <-----+----->
-
-	const int16_t sample_i[4] = {(int16_t)-qq, (int16_t)-ii, qq, ii};
-	const int16_t sample_q[4] = {ii, (int16_t)-qq, (int16_t)-ii, qq};
-	int16_t i = sample_i[ssb_phase];
-	int16_t q = sample_q[ssb_phase];
-
-	uint16_t magnitude;
-	int16_t phase;
-
-	cordic_rectangular_to_polar(i, q, magnitude, phase);
-	int16_t tracked_frequency = last_phase-phase;
-	last_phase = phase;
-
-	int16_t freq_at_sample = (int32_t)tracked_frequency*samplerate>>16;
-
-	static uint32_t smoothed_freq_at_sample = 0;
-	smoothed_freq_at_sample = ((smoothed_freq_at_sample << 3) + freq_at_sample - smoothed_freq_at_sample) >> 3;
-	return std::min(std::max(smoothed_freq_at_sample, 1000u), 2400u);
-}
-
 namespace fasstv {
 
 	SSTVDecode& SSTVDecode::The() {
@@ -91,52 +24,77 @@ namespace fasstv {
 		FreeBuffers();
 	}
 
-	float SSTVDecode::AverageFreqAtArea(float pos_ms, int width_samples /*= 10*/, std::string debug_text /*= ""*/) {
-		if (width_samples <= 1) {
-			// just get the sample at pos_ms
-			float smp = samples_freq[(pos_ms / 1000.f) * samplerate];
+	double SSTVDecode::FreqIntegralTo(double smp) const {
+		// each frequency sample covers [i, i + 1), so the integral between samples is a straight line
+		double pos = std::clamp(smp - freq_start_smp, 0.0, static_cast<double>(samples_freq.size()));
+		size_t idx = static_cast<size_t>(pos);
+		if (idx >= samples_freq.size())
+			return freq_prefix.back();
 
-#ifdef FASSTV_DEBUG
-			debug_AverageFreqInfo.emplace_back(pos_ms, width_samples, NAN, NAN, smp, smp, debug_text);
-#endif
+		return freq_prefix[idx] + ((pos - idx) * samples_freq[idx]);
+	}
 
-			return smp;
-		}
+	float SSTVDecode::AverageFreqBetween(double from_smp, double to_smp) const {
+		if (samples_freq.empty())
+			return 0.f;
 
-		int rangeCenter = (pos_ms / 1000.f) * samplerate;
-		int rangeMin = rangeCenter - (width_samples / 2);
-		int rangeMax = rangeCenter + (width_samples / 2);
+		// too thin to average, just take the sample we're on
+		if (to_smp - from_smp < 1.0) {
+			int idx = std::clamp<int>(from_smp - freq_start_smp, 0, (int)samples_freq.size() - 1);
+			return samples_freq[idx];
+		}
 
-		rangeMin = std::clamp(rangeMin, 0, (int)samples_freq.size() - 1);
-		rangeMax = std::clamp(rangeMax, 0, (int)samples_freq.size() - 1);
+		return (FreqIntegralTo(to_smp) - FreqIntegralTo(from_smp)) / (to_smp - from_smp);
+	}
 
-		//LogDebug("AverageFreqAtArea checking {}-{}", rangeMin, rangeMax);
+	float SSTVDecode::FreqVarianceBetween(int from_smp, int to_smp, float mean) const {
+		int from = std::max(from_smp - freq_start_smp, 0);
+		int to = std::min(to_smp - freq_start_smp, static_cast<int>(samples_freq.size()));
+		if (to <= from)
+			return 0.f;
 
-		std::vector<float> samplesToAverage;
-		samplesToAverage.resize(rangeMax - rangeMin);
+		double sum = 0.0;
+		for (int i = from; i < to; i++)
+			sum += (samples_freq[i] - mean) * (samples_freq[i] - mean);
 
-		std::copy(&samples_freq[rangeMin], &samples_freq[rangeMax], samplesToAverage.data());
+		return sum / (to - from);
+	}
 
-		float avg = 0;
-		for (int i = 0; i < samplesToAverage.size(); i++) {
-			avg += samplesToAverage[i];
-		}
-		avg /= samplesToAverage.size();
+	float SSTVDecode::AverageFreqAtArea(float pos_ms, int width_samples /*= 10*/, std::string_view label /*= {}*/) {
+		double center = (pos_ms / 1000.0) * samplerate;
+		float avg = AverageFreqBetween(center - (width_samples / 2.0), center + (width_samples / 2.0));
 
-#ifdef FASSTV_DEBUG
-		debug_AverageFreqInfo.emplace_back(pos_ms, width_samples, NAN, NAN, avg, avg, debug_text);
-#endif
+		if constexpr (DECODE_TRACING)
+			Trace(pos_ms, width_samples, NAN, NAN, avg, avg, label);
 
 		return avg;
 	}
 
-	bool SSTVDecode::AverageFreqAtAreaExpected(float pos_ms, float freq_expected, float freq_margin /*= 50.f*/, int width_samples /*= 10*/, float* freq_back /*= nullptr*/, std::string debug_text /*= ""*/) {
+	void SSTVDecode::Trace(float pos_ms, int width_samples, float freq_expected, float freq_margin, float freq_back, float ret, std::string_view label, int field /*= -1*/, int pixel /*= -1*/) {
+		DecodeTraceEntry& entry = trace.emplace_back();
+		entry.pos_ms = pos_ms;
+		entry.width_samples = width_samples;
+		entry.freq_expected = freq_expected;
+		entry.freq_margin = freq_margin;
+		entry.freq_back = freq_back;
+		entry.ret = ret;
+		entry.field = field;
+		entry.pixel = pixel;
+
+		// copied, the instructions the names come from get rebuilt
+		size_t len = std::min(label.size(), sizeof(entry.label) - 1);
+		memcpy(entry.label, label.data(), len);
+		entry.label[len] = '\0';
+	}
+
+	bool SSTVDecode::AverageFreqAtAreaExpected(float pos_ms, float freq_expected, float freq_margin /*= 50.f*/, int width_samples /*= 10*/, float* freq_back /*= nullptr*/, std::string_view label /*= {}*/) {
 		if (freq_expected < 0) {
 			LogError("Looking for a negative frequency...?");
 			return false;
 		}
 
-		float avg = AverageFreqAtArea(pos_ms, width_samples);
+		double center = (pos_ms / 1000.0) * samplerate;
+		float avg = AverageFreqBetween(center - (width_samples / 2.0), center + (width_samples / 2.0));
 
 		if (freq_back)
 			*freq_back = avg;
@@ -144,9 +102,8 @@ namespace fasstv {
 		bool tooBig = avg > freq_expected + (freq_margin / 2);
 		bool tooSmall = avg < freq_expected - (freq_margin / 2);
 
-#ifdef FASSTV_DEBUG
-		debug_AverageFreqInfo.emplace_back(pos_ms, width_samples, freq_expected, freq_margin, avg, (tooBig || tooSmall) ? 0 : 1, debug_text);
-#endif
+		if constexpr (DECODE_TRACING)
+			Trace(pos_ms, width_samples, freq_expected, freq_margin, avg, (tooBig || tooSmall) ? 0 : 1, label);
 
 		if (tooBig || tooSmall)
 			return false;
@@ -328,10 +285,12 @@ namespace fasstv {
 	int SSTVDecode::debug_GetSampleAtMouse(bool clamp /*= true*/) const {
 		int val = GetSampleAtTime(debug_GetTimeAtMouse());
 
-		if (!clamp && (val < 0 || val > samples_freq.size() - 1))
+		// samples_freq only holds what's still demodulated, from freq_start_smp on
+		const int last = freq_start_smp + static_cast<int>(samples_freq.size()) - 1;
+		if (last < freq_start_smp || (!clamp && (val < freq_start_smp || val > last)))
 			return -1;
 
-		return std::clamp<int>(val, 0, samples_freq.size() - 1);
+		return std::clamp<int>(val, freq_start_smp, last);
 	}
 
 	float SSTVDecode::debug_GetFreqAtMouse() const {
@@ -389,7 +348,7 @@ namespace fasstv {
 		float textX = x + 2, textY = y - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE - 2;
 
 		if(leftClick && smp != -1) {
-			freq = samples_freq[smp];
+			freq = samples_freq[smp - freq_start_smp];
 			float freqOnScreen = debug_GetScreenPosAtFreq(freq);
 
 			if(y < freqOnScreen)
@@ -521,12 +480,15 @@ namespace fasstv {
 				break;
 			}
 
-			// do nothing while we're off screen
-			if (p < 0)
+			// do nothing while we're off screen or before what's still demodulated, and stop past the end of it
+			const int freq_idx = static_cast<int>(p) - freq_start_smp;
+			if (p < 0 || freq_idx < 0)
 				continue;
+			if (freq_idx >= static_cast<int>(samples_freq.size()) || static_cast<size_t>(p) >= samples.size())
+				break;
 
-			float frequency = samples_freq[p];
-			float amplitude = samples[p];
+			float frequency = samples_freq[freq_idx];
+			float amplitude = samples[static_cast<size_t>(p)];
 
 			if (p == startSample) {
 				lastSample = p;
@@ -563,8 +525,8 @@ namespace fasstv {
 
 		const float viewingMargin = 0; //debug_GetGraphWidthInSeconds() / 16.f;
 
-		for (int i = 0; i < debug_AverageFreqInfo.size(); i++) {
-		 	auto& info = debug_AverageFreqInfo[i];
+		for (int i = 0; i < trace.size(); i++) {
+		 	auto& info = trace[i];
 
 		 	// haven't reached our window yet...
 		 	if ((info.pos_ms / 1000.f) + ((float)(info.width_samples * 4) / samplerate) <= debug_graphFreqXPos + viewingMargin)
@@ -594,8 +556,12 @@ namespace fasstv {
 					SDL_SetRenderDrawColor(debug_renderer, 255, 255, 0, 255);
 					SDL_RenderLine(debug_renderer, sampMax, freqYObserved, sampMax, freqYObserved);
 
-					if (!info.debug_text.empty() && debug_drawAverageFreqType >= 4)
-						SDL_RenderDebugText(debug_renderer, sampMin, freqYObserved, info.debug_text.c_str());
+					if (debug_drawAverageFreqType >= 4) {
+						if (info.field >= 0)
+							SDL_RenderDebugText(debug_renderer, sampMin, freqYObserved, std::format("F{}_P{}", info.field, info.pixel).c_str());
+						else if (info.label[0] != '\0')
+							SDL_RenderDebugText(debug_renderer, sampMin, freqYObserved, info.label);
+					}
 				}
 			}
 			else {
@@ -625,8 +591,8 @@ namespace fasstv {
 					SDL_FRect rect {sampMin, freqYExpected - freqYMargin, sampMax - sampMin, freqYMargin * 2};
 					SDL_RenderRect(debug_renderer, &rect);
 
-					if (!info.debug_text.empty() && debug_drawAverageFreqType >= 4)
-						SDL_RenderDebugText(debug_renderer, sampMin, freqYExpected + freqYMargin + 1, info.debug_text.c_str());
+					if (info.label[0] != '\0' && debug_drawAverageFreqType >= 4)
+						SDL_RenderDebugText(debug_renderer, sampMin, freqYExpected + freqYMargin + 1, info.label);
 				}
 			}
 		}
@@ -737,19 +703,46 @@ namespace fasstv {
 	}
 #endif
 
-	void SSTVDecode::DecodeSamples(std::vector<float>& samples, int samplerate, SSTV::Mode* expectedMode /*= nullptr*/, bool expectedFallback /*= false*/) {
+	void SSTVDecode::DecodeSamples(std::span<const float> samples, int samplerate, SSTV::Mode* expectedMode /*= nullptr*/, bool expectedFallback /*= false*/) {
+		// one-shot, the whole recording goes through the same path as a live feed
+		StartStream(samplerate, expectedMode, expectedFallback);
+		PushSamples(samples);
+		FinishStream();
+	}
+
+	void SSTVDecode::DecodeSamples(std::span<const std::int16_t> samples, int samplerate, SSTV::Mode* expectedMode /*= nullptr*/, bool expectedFallback /*= false*/) {
+		StartStream(samplerate, expectedMode, expectedFallback);
+		PushSamples(samples);
+		FinishStream();
+	}
+
+	void SSTVDecode::StartStream(int samplerate, SSTV::Mode* expectedMode /*= nullptr*/, bool expectedFallback /*= false*/) {
 		this->samples.clear();
 		this->samples_freq.clear();
-		this->samples = samples;
-		this->samplerate = samplerate;
+		this->freq_prefix.assign(1, 0.0);
+
+		// everything past here only ever sees the internal rate, or less. upsampling adds nothing but work and noise
+		this->samplerate = resampling ? std::min(samplerate, INTERNAL_SAMPLERATE) : samplerate;
+		this->resampler = SSTVResampler(samplerate, this->samplerate);
 		this->has_started = false;
 		this->is_done = false;
 		this->decoded_mode = nullptr;
 		this->highest_field_encountered = -1;
+		this->pending_scans.clear();
+		this->line_quality.clear();
 
-		FreeBuffers();
+		expected_mode = expectedMode;
+		expected_fallback = expectedFallback;
 
-		cordic_init();
+		// a retained image is kept around for partial transmissions to patch into
+		if (!retain_image)
+			FreeBuffers();
+
+		if constexpr (DECODE_TRACING) {
+			// enough for the header, StartLines makes room for the rest
+			trace.clear();
+			trace.reserve(256);
+		}
 
 #ifdef FASSTV_DEBUG
 		debug_DebugWindowSetup();
@@ -757,244 +750,1297 @@ namespace fasstv {
 
 		has_started = true;
 
-		LogInfo("Getting frequencies...");
-
-		// replace all samples with their estimated frequency (I simply don't care about it anymore)
-		samples_freq.resize(samples.size());
-		for (int i = 0; i < samples.size(); i++)
-			samples_freq[i] = rolling_freq_from_sample(samples[i] * INT16_MAX, samplerate);
-
-		auto sstv = SSTV::The();
-		std::vector<SSTV::Instruction> instructions;
+		auto& sstv = SSTV::The();
+		instructions.clear();
 
 		sstv.CreateVOXHeader(instructions);
-		int instVISStart = instructions.size();
+		inst_vis_start = instructions.size();
 		sstv.CreateVISHeader(instructions, 0);
-		int instVISEnd = instructions.size();
+		inst_vis_end = instructions.size();
 
-		int fudge_smp = 35; // fudge factor for frequency checking. accounts for the delay from the filter
+		// nothing from the last stream should bleed into this one
+		if (demodulator == nullptr || demodulator->GetType() != demodulator_type)
+			demodulator = SSTVDemodulator::Create(demodulator_type);
+		demodulator->Reset();
 
-		int progress_smp = 0.f + fudge_smp;
+		freq_start_smp = 0;
+		stream_base_smp = 0;
+		progress_smp = resampler.GetDelaySamples() + demodulator->GetDelaySamples(samplerate);
+		progress_frac = 0.0;
+		cur_instruction = 0;
+		cur_line = -1;
+		next_line_to_emit = 0;
 
 		// let's do VIS and VOX
 		// check for the VIS code, then run CreateInstructions with the mode we figure it is
-		// start the next instructions at instVISEnd
-		std::uint8_t vis_code = 0;
-		bool vis_parity = false;
+		vis_code = 0;
+		parametric_mode = nullptr;
+		loop_bands.clear();
+		band_count = 0;
+		header_parity = false;
+		stream_finishing = false;
+
+		if (start_search) {
+			start_detector = SSTVStartDetector(this->samplerate);
+			stream_state = StreamState::Searching;
+
+			// a transmission could be heard without its VIS, so keep an eye out for lines too
+			if (line_detection) {
+				line_detector = SSTVLineDetector(this->samplerate, expected_mode);
+				detect_next_smp = SecondsToSamples(DETECT_INTERVAL_MS / 1000.f);
+			}
 
-		LogInfo("Reading header...");
+			LogInfo("Looking for a transmission...");
+		}
+		else {
+			stream_state = StreamState::Header;
 
-		for (int i = 0; i < instructions.size(); i++) {
-			auto& ins = instructions[i];
+			LogInfo("Reading header...");
+		}
+	}
 
-			int width_samples = (ins.length_ms / 1000.f) * samplerate;
-			float center = (GetTimeAtSample(progress_smp) * 1000.f) + (ins.length_ms / 2.f);
-			float back = 0.f;
+	void SSTVDecode::PushSamples(std::span<const float> samples) {
+		// a whole recording pushed at once still only gets demodulated a window at a time,
+		// so nothing is kept past what the instruction we're on needs
+		while (!samples.empty() && has_started && !is_done) {
+			size_t count = std::min<size_t>(samples.size(), PUSH_WINDOW);
+			PushWindow(samples.first(count));
+			samples = samples.subspan(count);
+		}
 
-			if (i < instVISStart) {
-				//LogDebug("Ins {} tracking at {}ms", ins.name, center);
-				AverageFreqAtAreaExpected(center, ins.pitch, 30.f, width_samples / 2, &back, ins.name);
+		// nothing's left half done between pushes
+		FlushScans();
+	}
+
+	void SSTVDecode::PushSamples(std::span<const std::int16_t> samples) {
+		std::vector<float> window(std::min<size_t>(samples.size(), PUSH_WINDOW));
+
+		while (!samples.empty() && has_started && !is_done) {
+			size_t count = std::min<size_t>(samples.size(), PUSH_WINDOW);
+			for (size_t i = 0; i < count; i++)
+				window[i] = samples[i] / 32768.f;
+
+			PushWindow(std::span<const float>(window).first(count));
+			samples = samples.subspan(count);
+		}
+
+		FlushScans();
+	}
+
+	void SSTVDecode::PushWindow(std::span<const float> samples) {
+		if (!has_started || is_done)
+			return;
+
+		if (!resampler.IsPassthrough()) {
+			resampled.clear();
+			resampler.Process(samples, resampled);
+			samples = resampled;
+		}
+
+#ifdef FASSTV_DEBUG
+		// the debug window wants the whole recording
+		this->samples.insert(this->samples.end(), samples.begin(), samples.end());
+#endif
+
+		if (stream_state == StreamState::Searching) {
+			std::span<const float> rest = SearchForStart(samples);
+
+			if (stream_state == StreamState::Searching) {
+				// nothing gets demodulated until there's something to read, unless the lines are being looked for too
+				if (!line_detection || !DemodulateSearch(samples))
+					return;
+
+				if (!SearchForLines())
+					return;
+
+				rest = {};
 			}
-			else if (i >= instVISStart + 3 && i < instVISEnd) {
-				// we're in vis, let's read it!
-				int vis_idx = i - instVISStart - 3;
 
-				//LogDebug("Ins {}, vis idx {}", ins.name, vis_idx);
+			samples = rest;
+		}
 
-				if (vis_idx == 0 || vis_idx == 9) {
-					// start/end
-					bool inRange = AverageFreqAtAreaExpected(center, ins.pitch, 30.f, width_samples / 2, &back, ins.name);
+		DemodulateSamples(samples);
+		RunStream();
+	}
 
-					if (!inRange)
-						LogError("oops, what we thought was VIS didn't start/end properly (wrong pitch, {} vs expected {})", back, ins.pitch);
-				}
-				else if (vis_idx > 0 && vis_idx < 8) {
-					// put the vis code together
-					std::uint8_t bit = vis_idx - 1;
-					bool bitOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 30.f, width_samples / 2, &back, ins.name);
+	void SSTVDecode::DemodulateSamples(std::span<const float> samples) {
+		// replace all samples with their estimated frequency (I simply don't care about it anymore)
+		size_t start = samples_freq.size();
+		samples_freq.resize(start + samples.size());
+		demodulator->Process(samples.data(), &samples_freq[start], samples.size(), samplerate);
+
+		// doubles keep the running sum exact for the integer demodulators, and near enough for the rest
+		freq_prefix.resize(samples_freq.size() + 1);
+		for (size_t i = start; i < samples_freq.size(); i++)
+			freq_prefix[i + 1] = freq_prefix[i] + samples_freq[i];
+	}
+
+	std::span<const float> SSTVDecode::SearchForStart(std::span<const float> samples) {
+		// feed the detector a block at a time, so we can pick up right where the header is
+		const int block = start_detector.GetBlockSize();
+
+		for (size_t i = 0; i < samples.size(); i += block) {
+			start_detector.PushSamples(samples.subspan(i, std::min<size_t>(block, samples.size() - i)));
+
+			if (start_detector.GetStarts().empty())
+				continue;
+
+			std::int64_t start = start_detector.GetStarts().front();
+
+#ifdef FASSTV_DEBUG
+			// the debug window wants the whole recording
+			std::int64_t demod_from = 0;
+			std::span<const float> pending = std::span<const float>(this->samples).first(start_detector.GetSamplesPushed());
+#else
+			// give the filter a little bit to settle before the leader
+			std::int64_t demod_from = std::max<std::int64_t>(start - SecondsToSamples(0.02f), start_detector.GetHistoryStart());
+			std::span<const float> pending = start_detector.GetHistory(demod_from);
+#endif
+
+#ifndef FASSTV_DEBUG
+			// everything from here on counts from just before the header
+			stream_base_smp = demod_from;
+#endif
+
+			LogInfo("Found a transmission at {}s", GetStreamTimeAtSample(start - stream_base_smp));
+
+			// whatever was demodulated looking for lines starts over, from just before the header
+			samples_freq.clear();
+			freq_prefix.assign(1, 0.0);
+			freq_start_smp = demod_from - stream_base_smp;
+			demodulator->Reset();
+			DemodulateSamples(pending);
+
+			// VOX is optional, go straight to the VIS. the detector saw the resampled audio, so only the demodulator's late
+			progress_smp = (start - stream_base_smp) + demodulator->GetDelaySamples(samplerate);
+			progress_frac = 0.0;
+			cur_instruction = inst_vis_start;
+			stream_state = StreamState::Header;
+
+			LogInfo("Reading header...");
+
+			return samples.subspan(std::min(i + block, samples.size()));
+		}
+
+		return {};
+	}
+
+	void SSTVDecode::FinishStream() {
+		if (!has_started || is_done)
+			return;
+
+		if (stream_state == StreamState::Searching)
+			LogInfo("Couldn't find a transmission");
+
+		// whatever's left gets read with what we have
+		stream_finishing = true;
+		RunStream();
+		FlushScans();
+
+		if (stream_state == StreamState::Lines) {
+			FinishLines();
+			return;
+		}
+
+		stream_state = StreamState::Done;
+		is_done = true;
+	}
+
+	void SSTVDecode::FinishLines() {
+		FlushScans();
+
+		LogInfo("Done reading!");
+
+		// finish off the last lines, and anything we never got to
+		EmitLinesBefore(decoded_mode->lines);
+
+		LogInfo("Assembled image!");
+
+		stream_state = StreamState::Done;
+		is_done = true;
+	}
+
+	bool SSTVDecode::HasSamplesUpTo(int smp) const {
+		// leave a couple samples for rounding from the ms based positions
+		return stream_finishing || smp + 2 < freq_start_smp + static_cast<int>(samples_freq.size());
+	}
+
+	void SSTVDecode::DiscardSamplesBefore(int smp) {
+#ifndef FASSTV_DEBUG
+		// queued scans haven't read theirs yet
+		if (!pending_scans.empty())
+			smp = std::min<int>(smp, std::floor(pending_scans.front().start_smp));
+
+		// a stream being finished can run past the end of what it has
+		int discard = std::min<int>(smp - freq_start_smp, samples_freq.size());
+
+		// only shuffle things down once there's a decent amount to get rid of
+		if (discard <= 0 || discard < static_cast<int>(samples_freq.size()) / 2)
+			return;
+
+		samples_freq.erase(samples_freq.begin(), samples_freq.begin() + discard);
+		freq_prefix.erase(freq_prefix.begin(), freq_prefix.begin() + discard);
+		freq_start_smp += discard;
+#endif
+	}
+
+	void SSTVDecode::RunStream() {
+		while (!is_done) {
+			bool progressed = false;
+
+			switch (stream_state) {
+				case StreamState::Searching:
+					break;
+				case StreamState::Header:
+					progressed = StepHeader();
+					break;
+				case StreamState::ParametricHeader:
+					progressed = StepParametricHeader();
+					break;
+				case StreamState::BandMarker:
+				case StreamState::BandCount:
+				case StreamState::BandBody:
+					progressed = StepBandHeader();
+					break;
+				case StreamState::Detecting:
+					progressed = StepDetection();
+					break;
+				case StreamState::Lines:
+					progressed = StepLines();
+					break;
+				case StreamState::Done:
+					break;
+			}
+
+			if (!progressed)
+				return;
+		}
+	}
+
+	bool SSTVDecode::StepHeader() {
+		if (cur_instruction >= inst_vis_end) {
+			stream_state = SSTV::IsParametricVIS(vis_code) ? StreamState::ParametricHeader : StreamState::BandMarker;
+			return true;
+		}
+
+		auto& ins = instructions[cur_instruction];
+
+		int width_samples = (ins.length_ms / 1000.f) * samplerate;
+		if (!HasSamplesUpTo(progress_smp + width_samples))
+			return false;
 
-					if (bitOn)
-						vis_code = vis_code | static_cast<std::uint8_t>(1 << bit);
+		float center = (GetTimeAtSample(progress_smp) * 1000.f) + (ins.length_ms / 2.f);
+		float back = 0.f;
 
-					//LogDebug("VIS bit {}, {}. VIS is now {}", bit, bitOn, vis_code);
+		if (cur_instruction < inst_vis_start) {
+			//LogDebug("Ins {} tracking at {}ms", ins.name, center);
+			AverageFreqAtAreaExpected(center, ins.pitch, 30.f, width_samples / 2, &back, ins.name);
+		}
+		else if (cur_instruction >= inst_vis_start + 3) {
+			// we're in vis, let's read it!
+			int vis_idx = cur_instruction - inst_vis_start - 3;
+
+			//LogDebug("Ins {}, vis idx {}", ins.name, vis_idx);
+
+			if (vis_idx == 0 || vis_idx == 9) {
+				// start/end
+				bool inRange = AverageFreqAtAreaExpected(center, ins.pitch, 30.f, width_samples / 2, &back, ins.name);
+
+				if (!inRange)
+					LogError("oops, what we thought was VIS didn't start/end properly (wrong pitch, {} vs expected {})", back, ins.pitch);
+			}
+			else if (vis_idx > 0 && vis_idx < 8) {
+				// put the vis code together
+				std::uint8_t bit = vis_idx - 1;
+				bool bitOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 30.f, width_samples / 2, &back, ins.name);
+
+				if (bitOn)
+					vis_code = vis_code | static_cast<std::uint8_t>(1 << bit);
+
+				//LogDebug("VIS bit {}, {}. VIS is now {}", bit, bitOn, vis_code);
+			}
+			else if (vis_idx == 8) {
+				// check parity
+				// oh god this may be GCC only?
+				bool vis_parity = __builtin_parity(vis_code);
+
+				bool bitOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 30.f, width_samples / 2, &back, ins.name);
+
+				if (vis_parity != bitOn) {
+					LogError("bit parity was wrong!");
+					return StartLineDetection();
 				}
-				else if (vis_idx == 8) {
-					// check parity
-					// oh god this may be GCC only?
-					vis_parity = __builtin_parity(vis_code);
+			}
+		}
 
-					bool bitOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 30.f, width_samples / 2, &back, ins.name);
+		AdvanceProgress(ins.length_ms);
+		cur_instruction++;
 
-					if (vis_parity != bitOn) {
-						LogError("bit parity was wrong!");
-						is_done = true;
-						return;
-					}
+		DiscardSamplesBefore(progress_smp);
+		return true;
+	}
+
+	int SSTVDecode::ReadHeaderBits(int bits) {
+		const float bit_ms = SSTV::The().VIS_LENGTHS_MS[1];
+		const int bit_smp = SecondsToSamples(bit_ms / 1000.f);
+		float back = 0.f;
+
+		int value = 0;
+		for (int i = 0; i < bits; i++) {
+			float center = (GetTimeAtSample(progress_smp) * 1000.f) + (bit_ms / 2.f);
+
+			// within 100Hz of the 1 frequency is a 1, same as the VIS bits otherwise
+			bool bitOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 200.f, bit_smp / 2, &back, "Header bit");
+			if (bitOn) {
+				value |= 1 << i;
+				header_parity = !header_parity;
+			}
+
+			AdvanceProgress(bit_ms);
+		}
+
+		return value;
+	}
+
+	bool SSTVDecode::StepParametricHeader() {
+		// the VIS only said which layout, the size and timing come after it
+		const float bit_ms = SSTV::The().VIS_LENGTHS_MS[1];
+		const int bit_smp = SecondsToSamples(bit_ms / 1000.f);
+		float back = 0.f;
+
+		if (!HasSamplesUpTo(progress_smp + (bit_smp * ((SSTV::PARAMETRIC_HEADER_SIZE_BITS * 2) + SSTV::PARAMETRIC_HEADER_DWELL_BITS + 2))))
+			return false;
+
+		header_parity = false;
+
+		SSTV::ParametricModeParams params {};
+		params.layout = static_cast<SSTV::ParametricLayout>(vis_code - SSTV::PARAMETRIC_VIS_FIRST);
+		params.width = ReadHeaderBits(SSTV::PARAMETRIC_HEADER_SIZE_BITS);
+		params.lines = ReadHeaderBits(SSTV::PARAMETRIC_HEADER_SIZE_BITS);
+		params.pixel_dwell_us = ReadHeaderBits(SSTV::PARAMETRIC_HEADER_DWELL_BITS) / static_cast<float>(SSTV::PARAMETRIC_DWELL_STEPS_PER_US);
+
+		bool expected_parity = header_parity;
+		float center = (GetTimeAtSample(progress_smp) * 1000.f) + (bit_ms / 2.f);
+		bool parityOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 200.f, bit_smp / 2, &back, "Parametric parity");
+		AdvanceProgress(bit_ms);
+
+		// stop bit
+		AdvanceProgress(bit_ms);
+
+		if (parityOn != expected_parity) {
+			LogError("parametric header parity was wrong!");
+			return StartLineDetection();
+		}
+
+		parametric_mode = SSTV::CreateParametricMode(params);
+		if (parametric_mode == nullptr)
+			return StartLineDetection();
+
+		stream_state = StreamState::BandMarker;
+		return true;
+	}
+
+	bool SSTVDecode::StepBandHeader() {
+		// partial transmissions put their line bands right after the VIS
+		const float bit_ms = SSTV::The().VIS_LENGTHS_MS[1];
+		const int bit_smp = SecondsToSamples(bit_ms / 1000.f);
+		float back = 0.f;
+
+		switch (stream_state) {
+			case StreamState::BandMarker: {
+				if (!HasSamplesUpTo(progress_smp + (bit_smp * SSTV::BAND_HEADER_MARKER_BITS)))
+					return false;
+
+				// anything that turns out not to be a band header gets read again as lines
+				band_header_smp = progress_smp;
+				band_header_frac = progress_frac;
+
+				// no marker, no bands - a normal transmission. it has to be there for every bit, a sync pulse only lasts for part of one
+				for (int i = 0; i < SSTV::BAND_HEADER_MARKER_BITS; i++) {
+					float center = (GetTimeAtSample(progress_smp) * 1000.f) + (bit_ms / 2.f);
+					bool marker = AverageFreqAtAreaExpected(center, SSTV::BAND_HEADER_MARKER_FREQ, 100.f, bit_smp / 2, &back, "Band marker");
+					AdvanceProgress(bit_ms);
+
+					if (!marker)
+						return RestartAfterBandHeader();
 				}
+
+				header_parity = false;
+				stream_state = StreamState::BandCount;
+				return true;
 			}
+			case StreamState::BandCount:
+				if (!HasSamplesUpTo(progress_smp + (bit_smp * SSTV::BAND_HEADER_COUNT_BITS)))
+					return false;
+
+				band_count = ReadHeaderBits(SSTV::BAND_HEADER_COUNT_BITS);
+				if (band_count == 0) {
+					LogWarning("Band header with no bands, reading it as a whole transmission");
+					return RestartAfterBandHeader();
+				}
 
-			progress_smp += SecondsToSamples(ins.length_ms / 1000.f);
+				stream_state = StreamState::BandBody;
+				return true;
+			case StreamState::BandBody: {
+				// every band, then parity and stop
+				if (!HasSamplesUpTo(progress_smp + (bit_smp * ((band_count * SSTV::BAND_HEADER_LOOP_BITS * 2) + 2))))
+					return false;
+
+				for (int i = 0; i < band_count; i++) {
+					std::uint16_t first = ReadHeaderBits(SSTV::BAND_HEADER_LOOP_BITS);
+					std::uint16_t count = ReadHeaderBits(SSTV::BAND_HEADER_LOOP_BITS);
+					loop_bands.push_back({first, count});
+				}
+
+				bool expected_parity = header_parity;
+				float center = (GetTimeAtSample(progress_smp) * 1000.f) + (bit_ms / 2.f);
+				bool parityOn = AverageFreqAtAreaExpected(center, SSTV::The().VIS_BIT_FREQS[1], 200.f, bit_smp / 2, &back, "Band parity");
+				AdvanceProgress(bit_ms);
+
+				// stop bit
+				AdvanceProgress(bit_ms);
+
+				if (parityOn != expected_parity) {
+					LogWarning("Band header parity was wrong, reading it as a whole transmission");
+					return RestartAfterBandHeader();
+				}
+
+				SSTV::Mode* mode = SSTV::IsParametricVIS(vis_code) ? parametric_mode : SSTV::GetMode(vis_code);
+				if (!SSTV::AreLoopBandsValid(mode, loop_bands)) {
+					LogWarning("Band header doesn't fit the mode, reading it as a whole transmission");
+					return RestartAfterBandHeader();
+				}
+
+				return StartLines();
+			}
+			default:
+				return false;
 		}
+	}
+
+	bool SSTVDecode::RestartAfterBandHeader() {
+		// whatever was read as a band header was really the first line
+		progress_smp = band_header_smp;
+		progress_frac = band_header_frac;
+		loop_bands.clear();
+		band_count = 0;
+		return StartLines();
+	}
 
+	bool SSTVDecode::StartLines() {
 		// try to get our mode
-		decoded_mode = SSTV::GetMode(vis_code);
+		decoded_mode = SSTV::IsParametricVIS(vis_code) ? parametric_mode : SSTV::GetMode(vis_code);
 
 		if (decoded_mode != nullptr) {
 			LogInfo("Read as VIS code {}, which is mode {}", vis_code, decoded_mode->name);
-			if (expectedMode != nullptr && decoded_mode != expectedMode) {
-				if (expectedFallback) {
-					LogInfo("That wasn't expected, falling back to mode {} and continuing...", vis_code, expectedMode->name);
-					decoded_mode = expectedMode;
+			if (expected_mode != nullptr && decoded_mode != expected_mode) {
+				if (expected_fallback) {
+					LogInfo("That wasn't expected, falling back to mode {} and continuing...", expected_mode->name);
+					decoded_mode = expected_mode;
 				}
 				else {
-					LogInfo("Mode {} wasn't our expected mode ({}). Exiting...", decoded_mode->name, expectedMode->name);
+					LogInfo("Mode {} wasn't our expected mode ({}). Exiting...", decoded_mode->name, expected_mode->name);
 					is_done = true;
-					return;
+					return false;
 				}
 			}
 		}
 		else {
-			LogInfo("Read as VIS code {}, which is not something we know. Exiting...", vis_code);
-			is_done = true;
-			return;
+			LogInfo("Read as VIS code {}, which is not something we know", vis_code);
+			return StartLineDetection();
 		}
 
+		return PrepareLines();
+	}
+
+	bool SSTVDecode::PrepareLines(int first_loop /*= -1*/) {
 		// we're happy enough with this to get meta info
 		decoded_mode_meta = SSTVMetadata::GetModeMetadata(decoded_mode);
 		if (!decoded_mode_meta) {
 			is_done = true;
-			return;
+			return false;
 		}
 
 		// clear the instructions we had, and rebuild for the new mode
-		sstv.CreateInstructions(instructions, decoded_mode);
+		SSTV::The().CreateInstructions(instructions, decoded_mode, true, &loop_bands);
+
+		// skip over the parametric and band headers too, we've already read them
+		cur_instruction = inst_vis_end;
+
+		SSTV::ParametricModeParams params {};
+		if (SSTV::GetParametricParams(decoded_mode, params)) {
+			std::vector<SSTV::Instruction> parametric_header;
+			SSTV::CreateParametricHeader(parametric_header, params);
+			cur_instruction += parametric_header.size();
+		}
+
+		if (!loop_bands.empty()) {
+			std::vector<SSTV::Instruction> band_header;
+			SSTV::CreateBandHeader(band_header, loop_bands);
+			cur_instruction += band_header.size();
+
+			LogInfo("Partial transmission of {} band(s)", loop_bands.size());
+		}
 
 		LogInfo("Rebuilt instructions for {}", decoded_mode->name);
 
-		// alloc the working buffer (floats)
-		work_buf_size = decoded_mode->width * decoded_mode->lines * sizeof(float) * NUM_WORK_BUFFERS;
-		work_buf = static_cast<float*>(malloc(work_buf_size));
-		memset(work_buf, 0, work_buf_size);
+		cur_line = -1;
+		next_line_to_emit = 0;
 
-		// alloc the pixel buffer (RGB888)
-		pixel_buf_size = decoded_mode->width * decoded_mode->lines * sizeof(std::uint8_t) * NUM_CHANNELS;
-		pixel_buf = static_cast<std::uint8_t*>(malloc(pixel_buf_size));
-		memset(pixel_buf, 0, pixel_buf_size);
+		if (first_loop >= 0) {
+			// found from the lines, so we're coming in partway. nothing before the first loop we heard gets read
+			const int loop_instructions = std::count_if(decoded_mode->instructions_looping.begin() + decoded_mode->instruction_loop_start, decoded_mode->instructions_looping.end(),
+				[this](const SSTV::Instruction& ins) { return decoded_mode->uses_extra_lines || !(ins.flags & SSTV::InstructionFlags::ExtraLine); });
+
+			cur_instruction += decoded_mode->instruction_loop_start + (first_loop * loop_instructions);
+			cur_line = (first_loop * SSTV::GetLinesPerLoop(decoded_mode)) - 1;
+			next_line_to_emit = cur_line + 1;
+		}
+
+		if constexpr (DECODE_TRACING) {
+			// one entry per instruction, plus one per pixel of every scan
+			size_t scans = std::count_if(instructions.begin(), instructions.end(), [](const SSTV::Instruction& ins) { return ins.type == SSTV::InstructionType::Scan; });
+			trace.reserve(trace.size() + instructions.size() + (scans * decoded_mode->width));
+		}
+
+		// only patch into the retained image if it's the same mode, otherwise start fresh
+		if (work_buf == nullptr || retained_mode != decoded_mode)
+			AllocateBuffers(decoded_mode);
+		retained_mode = decoded_mode;
 
-		int cur_line = -1;
+		line_quality.assign(decoded_mode->lines, {});
+		line_tones.assign(decoded_mode->lines, {});
+		scan_clipped.assign(decoded_mode->lines * NUM_WORK_BUFFERS, -1);
+
+		// lines start off where the VIS (or the line detector) says, the syncs take it from there
+		sync_origin_smp = progress_smp;
+		sync_offset = 0.0;
+		sync_slope = std::isnan(expected_slope) ? 0.0 : expected_slope;
+		sync_bias = 0.0;
+		sync_sum_x = sync_sum_y = sync_sum_xx = sync_sum_xy = 0.0;
+		sync_count = 0;
 
 		// we have our mode, time for real instructions!
-		int loopEnd = instructions.size();
-		//loopEnd = instVISEnd + (ourMode->instructions_looping.size() - ourMode->instruction_loop_start) * 32;
-		for (int i = instVISEnd; i < loopEnd; i++) {
-			auto& ins = instructions[i];
+		stream_state = StreamState::Lines;
+		return true;
+	}
+
+	bool SSTVDecode::StartLineDetection() {
+		if (!line_detection) {
+			LogInfo("Exiting...");
+			is_done = true;
+			return false;
+		}
 
-			float center = (GetTimeAtSample(progress_smp) * 1000.f) + (ins.length_ms / 2.f);
-			int width_samples = (ins.length_ms / 1000.f) * samplerate;
+		// the lines should start right after the header, which is as good a guess as any as to which one we come in on
+		detect_reference_smp = progress_smp;
+		for (int i = cur_instruction; i < inst_vis_end; i++)
+			detect_reference_smp += SecondsToSamples(instructions[i].length_ms / 1000.f);
 
-			//LogDebug("Ins {} tracking at {}ms", ins.name, center);
+		line_detector = SSTVLineDetector(samplerate, expected_mode);
+		detect_next_smp = progress_smp + SecondsToSamples(DETECT_INTERVAL_MS / 1000.f);
+		detect_give_up_smp = progress_smp + (line_detector.GetWindowSamples() * DETECT_MAX_WINDOWS);
+		stream_state = StreamState::Detecting;
+
+		LogInfo("Working the mode out from the lines...");
+		return true;
+	}
+
+	bool SSTVDecode::StepDetection() {
+		const int end_smp = freq_start_smp + static_cast<int>(samples_freq.size());
+		if (end_smp < detect_next_smp && !stream_finishing)
+			return false;
+
+		const int from_smp = std::max(end_smp - line_detector.GetWindowSamples(), std::max(freq_start_smp, progress_smp));
+
+		SSTVLineDetector::Result result;
+		if (line_detector.Detect(std::span<const float>(samples_freq).subspan(from_smp - freq_start_smp), from_smp, result))
+			return StartDetectedLines(result);
+
+		if (stream_finishing || end_smp >= detect_give_up_smp) {
+			LogInfo("Couldn't work the mode out from the lines either. Exiting...");
+			is_done = true;
+			return false;
+		}
+
+		detect_next_smp = end_smp + SecondsToSamples(DETECT_INTERVAL_MS / 1000.f);
+		DiscardSamplesBefore(from_smp);
+		return false;
+	}
+
+	bool SSTVDecode::SearchForLines() {
+		// same as StepDetection, but the VIS might still turn up, and there's no header to count lines from
+		const int end_smp = freq_start_smp + static_cast<int>(samples_freq.size());
+		if (end_smp < detect_next_smp)
+			return false;
+
+		detect_next_smp = end_smp + SecondsToSamples(DETECT_INTERVAL_MS / 1000.f);
+
+		const int from_smp = std::max(end_smp - line_detector.GetWindowSamples(), freq_start_smp);
+
+		SSTVLineDetector::Result result;
+		if (!line_detector.Detect(std::span<const float>(samples_freq).subspan(from_smp - freq_start_smp), from_smp, result)) {
+			DiscardSamplesBefore(from_smp);
+			RebaseSearch();
+			return false;
+		}
+
+		LogInfo("Found lines with no VIS at {}s", GetStreamTimeAtSample(result.loop_start_smp));
+		detect_reference_smp = -1;
+		return StartDetectedLines(result);
+	}
 
-			float back = 0.f;
+	bool SSTVDecode::DemodulateSearch(std::span<const float> samples) {
+#ifdef FASSTV_DEBUG
+		// the debug window wants the whole recording
+		DemodulateSamples(samples);
+		return true;
+#else
+		// the start detector's already hearing every block for the VIS, so the demodulator and the line detector only
+		// run once it's heard what could be a few syncs. hours of silence or chatter cost next to nothing that way
+		const std::int64_t end_smp = start_detector.GetSamplesPushed();
+		if (start_detector.CountSyncBlocksSince(end_smp - line_detector.GetWindowSamples()) < DETECT_MIN_SYNC_BLOCKS) {
+			samples_freq.clear();
+			freq_prefix.assign(1, 0.0);
+			freq_start_smp = end_smp - stream_base_smp;
+			RebaseSearch();
+			return false;
+		}
 
-			float expectedPitch = ins.pitch;
-			if (ins.flags & SSTV::InstructionFlags::PitchUsesIndex) {
-				expectedPitch = decoded_mode->frequencies[ins.pitch];
+		if (!samples_freq.empty()) {
+			DemodulateSamples(samples);
+			return true;
+		}
+
+		// the lines didn't start just now, so pick the track up from as far back as the detector still has
+		const std::int64_t from_smp = std::max(start_detector.GetHistoryStart(), end_smp - line_detector.GetWindowSamples());
+		stream_base_smp = from_smp;
+		freq_start_smp = 0;
+		detect_next_smp = 0;
+		demodulator->Reset();
+		DemodulateSamples(start_detector.GetHistory(from_smp));
+		return true;
+#endif
+	}
+
+	void SSTVDecode::RebaseSearch() {
+		// nothing's been found, so nothing before what's still demodulated matters. it becomes sample 0,
+		// otherwise a long enough wait runs the positions out of int (and the float times taken from them out of precision)
+		const int shift = freq_start_smp;
+		stream_base_smp += shift;
+		freq_start_smp = 0;
+		detect_next_smp -= shift;
+	}
+
+	bool SSTVDecode::StartDetectedLines(const SSTVLineDetector::Result& result) {
+		decoded_mode = result.mode;
+		vis_code = decoded_mode->vis_code;
+		loop_bands.clear();
+
+		// which loop we've come in on, counting from the header if we saw where it ended
+		int first_loop = 0;
+		if (detect_reference_smp >= 0) {
+			double first_loop_smp = detect_reference_smp;
+			for (int i = 0; i < decoded_mode->instruction_loop_start; i++) {
+				const SSTV::Instruction& ins = decoded_mode->instructions_looping[i];
+				first_loop_smp += ((ins.flags & SSTV::InstructionFlags::LengthUsesIndex ? decoded_mode->timings[ins.length_ms] : ins.length_ms) / 1000.0) * samplerate;
 			}
-			else if (ins.flags & SSTV::InstructionFlags::PitchIsDelegated) {
-				// likely a scan
-				expectedPitch = (2300-1500)/2 + 1500;
+
+			const int loops = decoded_mode->lines / SSTV::GetLinesPerLoop(decoded_mode);
+			first_loop = std::clamp<int>(std::lround((result.loop_start_smp - first_loop_smp) / result.loop_smp), 0, loops - 1);
+		}
+
+		LogInfo("The lines look like mode {} ({:.0f}Hz off), coming in on line {}", decoded_mode->name, result.error_hz, first_loop * SSTV::GetLinesPerLoop(decoded_mode));
+
+		progress_smp = static_cast<int>(std::floor(result.loop_start_smp));
+		progress_frac = result.loop_start_smp - progress_smp;
+		return PrepareLines(first_loop);
+	}
+
+	bool SSTVDecode::StepLines() {
+		if (cur_instruction >= (int)instructions.size()) {
+			// that's the whole transmission, a live feed shouldn't have to end for it to come out
+			FinishLines();
+			return false;
+		}
+
+		auto& ins = instructions[cur_instruction];
+
+		// lines that weren't sent in a partial transmission
+		if (ins.type == SSTV::InstructionType::Skip) {
+			// doubled scans spill into the line after, which isn't getting sent
+			EmitLinesBefore(cur_line + 2);
+
+			cur_line += ins.pitch;
+			next_line_to_emit = std::max(next_line_to_emit, cur_line + 1);
+			cur_instruction++;
+			return true;
+		}
+
+		int width_samples = (ins.length_ms / 1000.f) * samplerate;
+		const int search_smp = SecondsToSamples(SYNC_SEARCH_MS / 1000.f);
+		const int reach_smp = sync_tracking ? search_smp + SecondsToSamples(SYNC_EDGE_MS / 1000.f) + 1 : 0;
+
+		// where this instruction really is, going by the syncs so far
+		const double nominal_smp = progress_smp + progress_frac;
+		const double start_smp = GetTrackedSample(nominal_smp);
+		const double end_smp = GetTrackedSample(nominal_smp + width_samples);
+		if (!HasSamplesUpTo(std::ceil(end_smp) + reach_smp))
+			return false;
+
+		// nothing looks behind the instruction we're on, give or take how far a sync gets searched for
+		DiscardSamplesBefore(std::floor(start_smp) - reach_smp);
+
+		const bool sync_expected = sync_tracking && IsLineSync(cur_instruction);
+		const double sync_error_smp = sync_expected ? TrackSync(start_smp, width_samples, search_smp) : NAN;
+
+		// the sync we just measured can move where this lands
+		float center = (GetTimeAtSample(GetTrackedSample(nominal_smp)) * 1000.f) + (ins.length_ms / 2.f);
+
+		//LogDebug("Ins {} tracking at {}ms", ins.name, center);
+
+		float back = 0.f;
+
+		float expectedPitch = ins.pitch;
+		if (ins.flags & SSTV::InstructionFlags::PitchUsesIndex) {
+			expectedPitch = decoded_mode->frequencies[ins.pitch];
+		}
+		else if (ins.flags & SSTV::InstructionFlags::PitchIsDelegated) {
+			// likely a scan
+			expectedPitch = (2300-1500)/2 + 1500;
+		}
+
+		//AverageFreqAtAreaExpected(center, expectedPitch, 50.f, width_samples, &back, ins.name);
+
+		if (ins.flags & SSTV::InstructionFlags::NewLine) {
+			cur_line++;
+
+			// nothing touches lines before the one we're on now, so they're done
+			EmitLinesBefore(cur_line);
+		}
+
+		const bool on_image = cur_line >= 0 && cur_line < decoded_mode->lines;
+		if (on_image && sync_expected) {
+			// straight into the picture (the B&W modes) there's no porch to hold the edge to, so one that wasn't heard
+			// might just be the picture hiding it and says nothing about the line
+			line_tones[cur_line].sync_expected = HasSyncPorch(cur_instruction) || !std::isnan(sync_error_smp);
+			line_quality[cur_line].sync_error_ms = (sync_error_smp / samplerate) * 1000.0;
+		}
+
+		if (ins.type != SSTV::InstructionType::Scan) {
+			// nothing acts on these, they only say how clean the line is
+			float margin = ins.type == SSTV::InstructionType::Sync ? 200.f : 40.f;
+			if (on_image)
+				MeasureTone(center, expectedPitch, margin, width_samples, ins.name);
+			else if constexpr (DECODE_TRACING)
+				AverageFreqAtAreaExpected(center, expectedPitch, margin, width_samples, &back, ins.name);
+		}
+		else if (on_image) {
+			if constexpr (DECODE_TRACING)
+				AverageFreqAtAreaExpected(center, 1900.f, 800.f, width_samples, nullptr, ins.name);
+
+			int field = std::clamp<int>(ins.pitch, 0, NUM_WORK_BUFFERS);
+			if (field > highest_field_encountered)
+				highest_field_encountered = field;
+
+			if (ins.pitch != field)
+				LogDebug("Scan field out of bounds for our working buffer");
+
+			// every pixel is the average over exactly its share of the scan, fractional samples and all.
+			// the share stretches with the sample rate error the syncs show
+			const double pixel_smp = (((ins.length_ms / 1000.0) * samplerate) / decoded_mode->width) * (1.0 + sync_slope);
+
+			PendingScan scan { cur_line, field, (ins.flags & SSTV::InstructionFlags::ScanIsDoubled) != 0, start_smp, pixel_smp };
+
+			// the trace isn't safe to fill from more than one thread
+			if (thread_pool != nullptr && !DECODE_TRACING)
+				QueueScan(scan);
+			else
+				DecodeScan(scan);
+		}
+
+		AdvanceProgress(ins.length_ms);
+		cur_instruction++;
+		return true;
+	}
+
+	void SSTVDecode::AdvanceProgress(float length_ms) {
+		// the fraction carries over, or every instruction would land a little early and the image would slant
+		double exact = progress_frac + ((length_ms / 1000.0) * samplerate);
+		int whole = static_cast<int>(std::floor(exact));
+		progress_frac = exact - whole;
+		progress_smp += whole;
+	}
+
+	double SSTVDecode::GetTrackedSample(double nominal_smp) const {
+		return nominal_smp + sync_offset + (sync_slope * (nominal_smp - sync_origin_smp));
+	}
+
+	bool SSTVDecode::IsLineSync(int instruction) const {
+		// the sync pulse itself, not the porch that shares its type
+		const SSTV::Instruction& ins = instructions[instruction];
+		if (ins.type != SSTV::InstructionType::Sync || !(ins.flags & SSTV::InstructionFlags::PitchUsesIndex) || decoded_mode->frequencies[ins.pitch] != SSTV::The().VIS_FREQS[0])
+			return false;
+
+		// right after the VIS stop bit there's no edge to line up against
+		const SSTV::Instruction& prev = instructions[instruction - 1];
+		float prev_pitch = prev.flags & SSTV::InstructionFlags::PitchUsesIndex ? decoded_mode->frequencies[prev.pitch] : prev.pitch;
+		return prev.type == SSTV::InstructionType::Skip || (prev.flags & SSTV::InstructionFlags::PitchIsDelegated) || prev_pitch != SSTV::The().VIS_FREQS[0];
+	}
+
+	bool SSTVDecode::HasSyncPorch(int instruction) const {
+		if (instruction + 1 >= static_cast<int>(instructions.size()))
+			return false;
+
+		const SSTV::Instruction& porch = instructions[instruction + 1];
+		return porch.type != SSTV::InstructionType::Scan && (porch.flags & SSTV::InstructionFlags::PitchUsesIndex) && decoded_mode->frequencies[porch.pitch] == SYNC_PORCH_FREQ;
+	}
+
+	double SSTVDecode::TrackSync(double predicted_smp, int width_samples, int search_smp) {
+		// matched filter against the end of the pulse, where it steps up to the porch. that edge has the same
+		// two levels every line, so whatever the picture is doing around it doesn't drag it about.
+		// prefix sums make every candidate O(1)
+		const double edge_smp = std::max((SYNC_EDGE_MS / 1000.0) * samplerate, 2.0);
+		const double predicted_edge = predicted_smp + width_samples + sync_bias;
+
+		// everything after the edge is at least as high as the porch, black included, so holding each sample to about it leaves
+		// next to nothing the picture does there to count. otherwise the step up into a bright scan just past a short porch
+		// (scottie's is 1.5ms) outscores the sync's own, and on the longer ones it still pulls the edge about
+		const float after_max = HasSyncPorch(cur_instruction) ? SYNC_PORCH_FREQ + SYNC_PORCH_SLACK : INFINITY;
+
+		// same as freq_prefix, held down, over just what the search can reach
+		const int first = std::clamp<int>(static_cast<int>(std::floor(predicted_edge)) - search_smp - freq_start_smp, 0, static_cast<int>(samples_freq.size()));
+		const int last = std::clamp<int>(static_cast<int>(std::ceil(predicted_edge + edge_smp)) + search_smp + 1 - freq_start_smp, first, static_cast<int>(samples_freq.size()));
+		sync_prefix.resize((last - first) + 1);
+		sync_prefix[0] = 0.0;
+		for (int i = first; i < last; i++)
+			sync_prefix[(i - first) + 1] = sync_prefix[i - first] + std::min(samples_freq[i], after_max);
+
+		auto after_integral_to = [&](double smp) {
+			double pos = std::clamp(smp - freq_start_smp - first, 0.0, static_cast<double>(last - first));
+			size_t idx = static_cast<size_t>(pos);
+			if (idx >= static_cast<size_t>(last - first))
+				return sync_prefix.back();
+
+			return sync_prefix[idx] + ((pos - idx) * std::min(samples_freq[first + idx], after_max));
+		};
+
+		auto score = [&](double at) { return static_cast<float>((after_integral_to(at + edge_smp) - after_integral_to(at)) / edge_smp) - AverageFreqBetween(at - edge_smp, at); };
+
+		int best = 0;
+		float best_score = score(predicted_edge);
+		for (int offset = -search_smp; offset <= search_smp; offset++) {
+			float candidate = score(predicted_edge + offset);
+			if (candidate > best_score) {
+				best_score = candidate;
+				best = offset;
+			}
+		}
+
+		// not a sync pulse we can hear
+		if (best_score < SYNC_MIN_STEP || AverageFreqBetween(predicted_edge + best - edge_smp, predicted_edge + best) > SYNC_MAX_FREQ)
+			return NAN;
+
+		// fit a parabola through the neighbours for the fraction of a sample
+		double refined = best;
+		if (best > -search_smp && best < search_smp) {
+			float before = score(predicted_edge + best - 1);
+			float after = score(predicted_edge + best + 1);
+			float curve = before - (2.f * best_score) + after;
+			if (curve < 0.f)
+				refined += 0.5 * (before - after) / curve;
+		}
+
+		double nominal_smp = progress_smp + progress_frac;
+		double x = nominal_smp - sync_origin_smp;
+		double y = (predicted_edge + refined) - (nominal_smp + width_samples);
+
+		// once there's a fit, anything way off it is noise that looked like a sync
+		if (sync_count >= SYNC_MIN_FOR_REJECTION) {
+			double residual = y - (sync_bias + sync_offset + (sync_slope * x));
+			if (std::abs(residual) > SecondsToSamples(SYNC_MAX_RESIDUAL_MS / 1000.f))
+				return residual;
+		}
+
+		sync_count++;
+		sync_sum_x += x;
+		sync_sum_y += y;
+		sync_sum_xx += x * x;
+		sync_sum_xy += x * y;
+
+		// a handful of syncs a line apart can't say much about the slope, a measured one is better until there's more
+		double denom = (sync_count * sync_sum_xx) - (sync_sum_x * sync_sum_x);
+		if (denom > 0.0 && (std::isnan(expected_slope) || sync_count > SYNC_MIN_FOR_REJECTION))
+			sync_slope = std::clamp(((sync_count * sync_sum_xy) - (sync_sum_x * sync_sum_y)) / denom, -SYNC_MAX_SLOPE, SYNC_MAX_SLOPE);
+		double intercept = (sync_sum_y - (sync_slope * sync_sum_x)) / sync_count;
+
+		// the filter smears the edge, so it always looks a little late. the first few lines say by how much,
+		// and the VIS already put us in the right place, so only movement after that counts
+		if (sync_count <= SYNC_MIN_FOR_BIAS)
+			sync_bias = intercept;
+
+		sync_offset = intercept - sync_bias;
+
+		// against the fit it's now part of
+		return y - (sync_bias + sync_offset + (sync_slope * x));
+	}
+
+	void SSTVDecode::MeasureTone(float center_ms, float expected_freq, float freq_margin, int width_samples, std::string_view label) {
+		// the demodulator smears the edges into whatever's either side, so what's left in the middle is all that's measured
+		const int width = width_samples - (2 * SecondsToSamples(QUALITY_EDGE_MS / 1000.f));
+		if (width < SecondsToSamples(QUALITY_EDGE_MS / 1000.f)) {
+			// too short to say anything about
+			if constexpr (DECODE_TRACING)
+				AverageFreqAtAreaExpected(center_ms, expected_freq, freq_margin, width_samples, nullptr, label);
+
+			return;
+		}
+
+		float freq = 0.f;
+		AverageFreqAtAreaExpected(center_ms, expected_freq, freq_margin, width, &freq, label);
+
+		const int from = std::lround(((center_ms / 1000.0) * samplerate) - (width / 2.0));
+
+		LineToneSums& sums = line_tones[cur_line];
+		sums.error_hz += std::abs(freq - expected_freq);
+		sums.tones++;
+		sums.variance += static_cast<double>(FreqVarianceBetween(from, from + width, freq)) * width;
+		sums.samples += width;
+	}
+
+	void SSTVDecode::FinishLineQuality(int line) {
+		DecodeLineQuality& quality = line_quality[line];
+
+		int scans = 0;
+		int clipped = 0;
+		for (int field = 0; field < NUM_WORK_BUFFERS; field++) {
+			int count = scan_clipped[(line * NUM_WORK_BUFFERS) + field];
+			if (count < 0)
+				continue;
+
+			scans++;
+			clipped += count;
+		}
+
+		// never sent, or never got to
+		if (scans == 0)
+			return;
+
+		quality.decoded = true;
+		quality.clipped = clipped / static_cast<float>(scans * decoded_mode->width);
+
+		float total = 1.f - quality.clipped;
+		int parts = 1;
+
+		// lines sent along with the one before (PD's pairs, Robot 4:2:0's extra lines) have no sync or tones of their own, so they share its
+		int source = line;
+		if (line > 0 && line_tones[line].tones == 0 && !line_tones[line].sync_expected)
+			source = line - 1;
+
+		const LineToneSums& sums = line_tones[source];
+		quality.sync_error_ms = line_quality[source].sync_error_ms;
+
+		if (sums.tones > 0) {
+			// a steady tone only wobbles from noise, so that against the 800Hz the picture gets is the SNR as far as the picture's concerned
+			constexpr double VIDEO_RANGE_HZ = 2300.0 - 1500.0;
+			double variance = std::max(sums.variance / sums.samples, 1.0);
+
+			quality.tone_error_hz = sums.error_hz / sums.tones;
+			quality.snr_db = 10.0 * std::log10((VIDEO_RANGE_HZ * VIDEO_RANGE_HZ) / variance);
+
+			total += 1.f - std::min(quality.tone_error_hz / QUALITY_MAX_TONE_ERROR_HZ, 1.f);
+			total += std::clamp(quality.snr_db / QUALITY_FULL_SNR_DB, 0.f, 1.f);
+			parts += 2;
+		}
+
+		// a sync that didn't turn up only counts against the line if there was one to listen for
+		if (sums.sync_expected) {
+			total += std::isnan(quality.sync_error_ms) ? 0.f : 1.f - std::min(std::abs(quality.sync_error_ms) / SYNC_MAX_RESIDUAL_MS, 1.f);
+			parts++;
+		}
+
+		quality.score = total / parts;
+	}
+
+	DecodeLineQuality SSTVDecode::GetImageQuality() const {
+		DecodeLineQuality image;
+
+		int lines = 0;
+		int synced = 0;
+		double sync_error = 0.0;
+		for (const DecodeLineQuality& quality : line_quality) {
+			if (!quality.decoded)
+				continue;
+
+			lines++;
+			image.tone_error_hz += quality.tone_error_hz;
+			image.snr_db += quality.snr_db;
+			image.clipped += quality.clipped;
+			image.score += quality.score;
+
+			if (!std::isnan(quality.sync_error_ms)) {
+				sync_error += std::abs(quality.sync_error_ms);
+				synced++;
 			}
+		}
 
-			//AverageFreqAtAreaExpected(center, expectedPitch, 50.f, width_samples, &back, ins.name);
+		if (lines == 0)
+			return image;
 
-			if (ins.flags & SSTV::InstructionFlags::NewLine)
-				cur_line++;
+		image.decoded = true;
+		image.sync_error_ms = synced > 0 ? sync_error / synced : NAN;
+		image.tone_error_hz /= lines;
+		image.snr_db /= lines;
+		image.clipped /= lines;
+		image.score /= lines;
+		return image;
+	}
+
+	void SSTVDecode::QueueScan(const PendingScan& scan) {
+		// scans writing the same part of the work buffer have to land in order, so don't let them share a batch
+		for (auto it = pending_scans.rbegin(); it != pending_scans.rend() && it->line >= scan.line - 1; ++it) {
+			if (it->field != scan.field)
+				continue;
 
-			if (ins.type != SSTV::InstructionType::Scan) {
-				AverageFreqAtAreaExpected(center, expectedPitch, ins.type == SSTV::InstructionType::Sync ? 200.f : 40.f, width_samples, &back, ins.name);
+			bool overlaps = it->line == scan.line || (it->doubled && it->line + 1 == scan.line) || (scan.doubled && scan.line + 1 == it->line);
+			if (overlaps) {
+				FlushScans();
+				break;
 			}
-			else {
-				AverageFreqAtAreaExpected(center, 1900.f, 800.f, width_samples, nullptr, ins.name);
+		}
 
-				int field = std::clamp<int>(ins.pitch, 0, NUM_WORK_BUFFERS);
-				if (field > highest_field_encountered)
-					highest_field_encountered = field;
+		pending_scans.push_back(scan);
 
-				float width_sampleSection = ins.length_ms / decoded_mode->width;
+		if (static_cast<int>(pending_scans.size()) >= SCAN_BATCH)
+			FlushScans();
+	}
 
-				for (int j = 0; j < decoded_mode->width; j++) {
-					float* work_val = &work_buf[((cur_line*decoded_mode->width) + j) * NUM_WORK_BUFFERS];
+	void SSTVDecode::FlushScans() {
+		if (pending_scans.empty())
+			return;
 
-					float freq = AverageFreqAtArea((GetTimeAtSample(progress_smp) * 1000.f) + (j * width_sampleSection), (width_sampleSection / 1000.f) * samplerate, std::format("F{}_P{}", field, j));
-					// normalize to 0.0-1.0
-					// width of range is 2300-1500 = 800
-					float freqAdj = (freq - 1500.f) / 800.f;
+		// every scan reads the frequency track and writes its own rows, nothing else
+		thread_pool->ParallelFor(pending_scans.size(), [this](int i) { DecodeScan(pending_scans[i]); });
+		pending_scans.clear();
 
-					// todo: put this behind an option
-					freqAdj = std::clamp<float>(freqAdj, 0.f, 1.f);
+		// lines held back for these can go out now
+		if (stream_state == StreamState::Lines)
+			EmitLinesBefore(cur_line);
+	}
 
-					if (freq > 0) {
-						if (ins.pitch != field)
-							LogDebug("Scan field out of bounds for our working buffer");
+	void SSTVDecode::DecodeScan(const PendingScan& scan) {
+		int clipped = 0;
 
-						work_val[field] = freqAdj;
+		for (int j = 0; j < decoded_mode->width; j++) {
+			float* work_val = &work_buf[((scan.line*decoded_mode->width) + j) * NUM_WORK_BUFFERS];
 
-						if (ins.flags & SSTV::InstructionFlags::ScanIsDoubled && cur_line < decoded_mode->lines - 1) {
-							work_val = &work_buf[(((cur_line+1)*decoded_mode->width) + j) * NUM_WORK_BUFFERS];
-							work_val[field] = freqAdj;
-						}
-					}
+			double pixel_start = scan.start_smp + (j * scan.pixel_smp);
+			float freq = AverageFreqBetween(pixel_start, pixel_start + scan.pixel_smp);
+
+			if constexpr (DECODE_TRACING)
+				Trace(GetTimeAtSample(pixel_start) * 1000.f, static_cast<int>(scan.pixel_smp), NAN, NAN, freq, freq, {}, scan.field, j);
+
+			// normalize to 0.0-1.0
+			// width of range is 2300-1500 = 800
+			float freqAdj = (freq - 1500.f) / 800.f;
+
+			if (freq > 0 && (freq < 1500.f - QUALITY_CLIP_MARGIN_HZ || freq > 2300.f + QUALITY_CLIP_MARGIN_HZ))
+				clipped++;
+
+			// todo: put this behind an option
+			freqAdj = std::clamp<float>(freqAdj, 0.f, 1.f);
+
+			if (freq > 0) {
+				work_val[scan.field] = freqAdj;
+
+				if (scan.doubled && scan.line < decoded_mode->lines - 1) {
+					work_val = &work_buf[(((scan.line+1)*decoded_mode->width) + j) * NUM_WORK_BUFFERS];
+					work_val[scan.field] = freqAdj;
 				}
 			}
+		}
+
+		// every scan has its own slot, so scans of the same line on different threads don't fight over it.
+		// one read past the end of a stream that stopped early wasn't heard at all
+		if (scan.start_smp < freq_start_smp + static_cast<double>(samples_freq.size()))
+			scan_clipped[(scan.line * NUM_WORK_BUFFERS) + scan.field] = clipped;
+	}
+
+	void SSTVDecode::EmitLinesBefore(int line) {
+		line = std::min<int>(line, decoded_mode->lines);
 
-			progress_smp += SecondsToSamples(ins.length_ms / 1000.f);
+		// queued scans can still write their lines (and the one after, if doubled)
+		if (!pending_scans.empty())
+			line = std::min<int>(line, pending_scans.front().line);
+
+		if (line <= next_line_to_emit)
+			return;
+
+		AssembleLines(next_line_to_emit, line);
+
+		for (; next_line_to_emit < line; next_line_to_emit++) {
+			FinishLineQuality(next_line_to_emit);
+
+			if (scanline_callback != nullptr)
+				scanline_callback(next_line_to_emit, &pixel_buf[next_line_to_emit * decoded_mode->width * NUM_CHANNELS], decoded_mode->width);
 		}
+	}
 
-		LogInfo("Done reading!");
+	void SSTVDecode::AssembleLines(int first, int end) {
+		// rows don't touch each other, so big stretches get split over the pool
+		int rows_per_job = std::max(1, ASSEMBLE_JOB_PIXELS / decoded_mode->width);
+		int jobs = (end - first + rows_per_job - 1) / rows_per_job;
+
+		if (thread_pool == nullptr || jobs < 2) {
+			for (int y = first; y < end; y++)
+				AssembleLine(y);
+
+			return;
+		}
+
+		thread_pool->ParallelFor(jobs, [this, first, end, rows_per_job](int job) {
+			int job_end = std::min(end, first + ((job + 1) * rows_per_job));
+			for (int y = first + (job * rows_per_job); y < job_end; y++)
+				AssembleLine(y);
+		});
+	}
+
+	void SSTVDecode::AssembleLine(int y) {
+		// make the working buffer into an image, one kernel per scan type over the whole row
+		const float* work = &work_buf[y * decoded_mode->width * NUM_WORK_BUFFERS];
+		std::uint8_t* pix = &pixel_buf[y * decoded_mode->width * NUM_CHANNELS];
+		const int width = decoded_mode->width;
+
+		switch (decoded_mode->scan_type) {
+			case SSTV::ScanType::Monochrome:
+			case SSTV::ScanType::Sweep:
+				AssembleRowMonochrome(work, pix, width);
+				break;
+			case SSTV::ScanType::RGB:
+				AssembleRowRGB(work, pix, width);
+				break;
+			case SSTV::ScanType::YRYBY:
+				AssembleRowYRYBY(work, pix, width);
+				break;
+			default:
+				break;
+		}
+
+		// if we never encountered an alpha channel, make alpha max
+		if (highest_field_encountered < 3) {
+			for (int x = 0; x < width; x++)
+				pix[(x * NUM_CHANNELS) + 3] = 255;
+		}
+		else {
+			for (int x = 0; x < width; x++)
+				pix[(x * NUM_CHANNELS) + 3] = WorkToByte(work[(x * NUM_WORK_BUFFERS) + 3]);
+		}
+	}
+
+	void SSTVDecode::AssembleRowMonochrome(const float* work, std::uint8_t* pix, int width) {
+		for (int x = 0; x < width; x++) {
+			int value = WorkToByte(work[x * NUM_WORK_BUFFERS]);
+			pix[(x * NUM_CHANNELS) + 0] = value;
+			pix[(x * NUM_CHANNELS) + 1] = value;
+			pix[(x * NUM_CHANNELS) + 2] = value;
+		}
+	}
+
+	void SSTVDecode::AssembleRowRGB(const float* work, std::uint8_t* pix, int width) {
+		for (int x = 0; x < width; x++) {
+			pix[(x * NUM_CHANNELS) + 0] = WorkToByte(work[(x * NUM_WORK_BUFFERS) + 0]);
+			pix[(x * NUM_CHANNELS) + 1] = WorkToByte(work[(x * NUM_WORK_BUFFERS) + 1]);
+			pix[(x * NUM_CHANNELS) + 2] = WorkToByte(work[(x * NUM_WORK_BUFFERS) + 2]);
+		}
+	}
+
+	void SSTVDecode::AssembleRowYRYBY(const float* work, std::uint8_t* pix, int width) {
+		// BT.601 studio swing to RGB in 16.16 fixed point, the old doubles (0.003906 * 298.082 and so on) times 65536
+		constexpr int Y_SCALE = 76304;
+		constexpr int R_FROM_RY = 104591;
+		constexpr int G_FROM_BY = -25673;
+		constexpr int G_FROM_RY = -53275;
+		constexpr int B_FROM_BY = 132193;
+
+		for (int x = 0; x < width; x++) {
+			const float* w = &work[x * NUM_WORK_BUFFERS];
+			int y = (WorkToByte(w[0]) - 16) * Y_SCALE;
+			int ry = WorkToByte(w[1]) - 128;
+			int by = WorkToByte(w[2]) - 128;
+
+			pix[(x * NUM_CHANNELS) + 0] = std::min(std::max((y + (R_FROM_RY * ry)) >> 16, 0), 255);
+			pix[(x * NUM_CHANNELS) + 1] = std::min(std::max((y + (G_FROM_BY * by) + (G_FROM_RY * ry)) >> 16, 0), 255);
+			pix[(x * NUM_CHANNELS) + 2] = std::min(std::max((y + (B_FROM_BY * by)) >> 16, 0), 255);
+		}
+	}
+
+	void SSTVDecode::AllocateBuffers(SSTV::Mode* mode) {
+		FreeBuffers();
+
+		// alloc the working buffer (floats)
+		work_buf_size = mode->width * mode->lines * sizeof(float) * NUM_WORK_BUFFERS;
+		work_buf = static_cast<float*>(malloc(work_buf_size));
+		memset(work_buf, 0, work_buf_size);
 
-		// make the working buffer into an image
+		// alloc the pixel buffer (RGBA8888)
+		pixel_buf_size = mode->width * mode->lines * sizeof(std::uint8_t) * NUM_CHANNELS;
+		pixel_buf = static_cast<std::uint8_t*>(malloc(pixel_buf_size));
+		memset(pixel_buf, 0, pixel_buf_size);
+	}
 
-		for (int x = 0; x < decoded_mode->width; x++) {
-			for (int y = 0; y < decoded_mode->lines; y++) {
-				float* work_val = &work_buf[((y*decoded_mode->width) + x) * NUM_WORK_BUFFERS];
+	bool SSTVDecode::LoadRetainedImage(SSTV::Mode* mode, const std::uint8_t* pixels, int width, int height, int pitch) {
+		if (mode == nullptr || pixels == nullptr)
+			return false;
+
+		if (width != mode->width || height != mode->lines) {
+			LogError("Image to patch into is {}x{}, but {} is {}x{}", width, height, mode->name, mode->width, mode->lines);
+			return false;
+		}
 
-				// if we never encountered an alpha channel, make alpha max
-				if (highest_field_encountered < 3)
-					work_val[3] = 1.f;
+		AllocateBuffers(mode);
 
-				std::uint8_t* pix = &pixel_buf[((y*decoded_mode->width) + x) * NUM_CHANNELS];
+		// lines that don't get sent are assembled again from the working buffer, so it has to hold the image too.
+		// bytes go in the middle of their step so WorkToByte gives them straight back
+		auto to_work = [](double byte) { return static_cast<float>((std::clamp(byte, 0.0, 255.0) + 0.5) / 255.0); };
 
-				std::uint8_t work_val_byte = std::clamp<std::uint8_t>(work_val[0] * 255, 0, 255);
+		for (int y = 0; y < height; y++) {
+			const std::uint8_t* src = &pixels[y * pitch];
+			std::uint8_t* pix = &pixel_buf[y * width * NUM_CHANNELS];
+			float* work = &work_buf[y * width * NUM_WORK_BUFFERS];
 
-				// worrying about checking this each time. slow?
-				// todo: make a handler function for each
-				switch (decoded_mode->scan_type) {
+			memcpy(pix, src, width * NUM_CHANNELS);
+
+			for (int x = 0; x < width; x++) {
+				const std::uint8_t* p = &src[x * NUM_CHANNELS];
+				float* w = &work[x * NUM_WORK_BUFFERS];
+				double R = p[0], G = p[1], B = p[2];
+
+				switch (mode->scan_type) {
+					case SSTV::ScanType::YRYBY:
+						// same as SSTVEncode::ScanYRYBY sends
+						w[0] = to_work(16.0 + (0.003906 * ((65.738 * R) + (129.057 * G) + (25.064 * B))));
+						w[1] = to_work(128.0 + (0.003906 * ((112.439 * R) + (-94.154 * G) + (-18.285 * B))));
+						w[2] = to_work(128.0 + (0.003906 * ((-37.945 * R) + (-74.494 * G) + (112.439 * B))));
+						break;
 					case SSTV::ScanType::Monochrome:
 					case SSTV::ScanType::Sweep:
-						pix[0] = pix[1] = pix[2] = work_val_byte;
+						// same as SSTVEncode::ScanMonochrome sends
+						w[0] = to_work((0.30 * R) + (0.59 * G) + (0.11 * B));
 						break;
-					case SSTV::ScanType::RGB:
-						for (int i = 0; i < NUM_CHANNELS; i++)
-							pix[i] = std::clamp<std::uint8_t>(work_val[i] * 255, 0, 255);
-						break;
-					case SSTV::ScanType::YRYBY:
-						std::uint8_t YRYBY[NUM_CHANNELS];
-						for (int i = 0; i < NUM_CHANNELS; i++)
-							YRYBY[i] = std::clamp<std::uint8_t>(work_val[i] * 255, 0, 255);
-
-						pix[0] = std::clamp(0.003906 * ((298.082 * (YRYBY[0] - 16.0)) + (408.583 *  (YRYBY[1] - 128.0))), 0., 255.);
-						pix[1] = std::clamp(0.003906 * ((298.082 * (YRYBY[0] - 16.0)) + (-100.291 * (YRYBY[2] - 128.0)) + (-208.12 * (YRYBY[1] - 128.0))), 0., 255.);
-						pix[2] = std::clamp(0.003906 * ((298.082 * (YRYBY[0] - 16.0)) + (516.411 *  (YRYBY[2] - 128.0))), 0., 255.);
-						pix[3] = YRYBY[3];
 					default:
+						w[0] = to_work(R);
+						w[1] = to_work(G);
+						w[2] = to_work(B);
 						break;
 				}
+
+				w[3] = to_work(p[3]);
 			}
 		}
 
-		LogInfo("Assembled image!");
-
-		is_done = true;
+		retained_mode = mode;
+		retain_image = true;
+		return true;
 	}
 
 	void SSTVDecode::FreeBuffers() {
@@ -1010,9 +2056,7 @@ namespace fasstv {
 			pixel_buf_size = 0;
 		}
 
-#ifdef FASSTV_DEBUG
-		debug_AverageFreqInfo.clear();
-#endif
+		retained_mode = nullptr;
 	}
 
 	std::uint8_t* SSTVDecode::GetPixels(size_t* out_size) const {
@@ -0,0 +1,179 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVDemodulator.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// Majority of frequency tracking code by Jon Dawson
+// https://github.com/dawsonjon/PicoSSTV
+
+// Works on a block of samples at a time. Each stage is a flat loop over arrays
+// (mix, half band FIR, un-mix, CORDIC, phase difference) so the compiler can vectorise it,
+// instead of one sample going through every stage with a circular buffer and branchy CORDIC.
+// The integer maths is the same as PicoSSTV's per-sample version, so the output is too.
+
+namespace fasstv {
+
+	// filter kernel from half_band_filter2, the outer taps pair up around the center
+	constexpr int FILTER_CENTER_TAP = 31;
+	constexpr int FILTER_CENTER_COEFF = 16384;
+	constexpr int FILTER_PAIRS = 15;
+	constexpr int FILTER_PAIR_TAPS[FILTER_PAIRS] = { 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+	constexpr int FILTER_PAIR_COEFFS[FILTER_PAIRS] = { 1, -6, 16, -32, 60, -102, 164, -254, 381, -561, 818, -1209, 1876, -3347, 10387 };
+
+	// round(atan(2^-i) * 32768 / pi), what cordic_init used to work out every time
+	constexpr int CORDIC_ITERATIONS = 16;
+	constexpr std::int16_t CORDIC_THETAS[CORDIC_ITERATIONS + 1] = { 8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1, 1, 0, 0 };
+	constexpr std::int32_t CORDIC_HALF_PI = 16384;
+
+	// shift frequency by +FS/4
+	constexpr std::int16_t MIX_I[4] = { 1, 0, -1, 0 };
+	constexpr std::int16_t MIX_Q[4] = { 0, -1, 0, 1 };
+
+	std::unique_ptr<SSTVDemodulator> SSTVDemodulator::Create(Type type) {
+		switch (type) {
+			case Type::ZeroCrossing:
+				return std::make_unique<ZeroCrossingDemodulator>();
+			case Type::Hilbert:
+				return std::make_unique<HilbertDemodulator>();
+			case Type::Goertzel:
+				return std::make_unique<GoertzelDemodulator>();
+			case Type::Cordic:
+			default:
+				return std::make_unique<CordicDemodulator>();
+		}
+	}
+
+	constexpr std::pair<SSTVDemodulator::Type, std::string_view> TYPE_NAMES[] = {
+		{ SSTVDemodulator::Type::Cordic, "cordic" },
+		{ SSTVDemodulator::Type::ZeroCrossing, "zerocrossing" },
+		{ SSTVDemodulator::Type::Hilbert, "hilbert" },
+		{ SSTVDemodulator::Type::Goertzel, "goertzel" },
+	};
+
+	std::string_view SSTVDemodulator::GetTypeName(Type type) {
+		for (const auto& [t, name] : TYPE_NAMES) {
+			if (t == type)
+				return name;
+		}
+
+		return "unknown";
+	}
+
+	bool SSTVDemodulator::GetTypeByName(std::string_view name, Type& type) {
+		for (const auto& [t, type_name] : TYPE_NAMES) {
+			if (type_name == name) {
+				type = t;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void CordicDemodulator::Reset() {
+		memset(filter_i, 0, sizeof(filter_i));
+		memset(filter_q, 0, sizeof(filter_q));
+		mix_phase = 0;
+		last_phase = 0;
+		smoothed_freq = 0;
+	}
+
+	void CordicDemodulator::Process(const float* in, float* out, size_t count, int samplerate) {
+		for (size_t done = 0; done < count; done += BLOCK_SIZE)
+			ProcessBlock(in + done, out + done, std::min<size_t>(BLOCK_SIZE, count - done), samplerate);
+	}
+
+	void CordicDemodulator::ProcessBlock(const float* in, float* out, int count, int samplerate) {
+		std::int16_t* new_i = filter_i + FILTER_HISTORY;
+		std::int16_t* new_q = filter_q + FILTER_HISTORY;
+
+		for (int n = 0; n < count; n++) {
+			std::int16_t audio = static_cast<std::int16_t>(std::clamp(in[n] * INT16_MAX, (float)INT16_MIN, (float)INT16_MAX)) >> 1;
+			int p = (mix_phase + n + 1) & 3;
+			new_i[n] = audio * MIX_I[p];
+			new_q[n] = audio * MIX_Q[p];
+		}
+
+		// filter -Fs/4 to +Fs/4
+		std::int32_t acc_i[BLOCK_SIZE];
+		std::int32_t acc_q[BLOCK_SIZE];
+
+		for (int n = 0; n < count; n++) {
+			acc_i[n] = filter_i[n + FILTER_CENTER_TAP] * FILTER_CENTER_COEFF;
+			acc_q[n] = filter_q[n + FILTER_CENTER_TAP] * FILTER_CENTER_COEFF;
+		}
+
+		for (int t = 0; t < FILTER_PAIRS; t++) {
+			const int lo = FILTER_PAIR_TAPS[t];
+			const int hi = (FILTER_CENTER_TAP * 2) - lo;
+			const std::int32_t coeff = FILTER_PAIR_COEFFS[t];
+
+			for (int n = 0; n < count; n++) {
+				acc_i[n] += (static_cast<std::int32_t>(filter_i[n + lo]) + filter_i[n + hi]) * coeff;
+				acc_q[n] += (static_cast<std::int32_t>(filter_q[n + lo]) + filter_q[n + hi]) * coeff;
+			}
+		}
+
+		// shift frequency by -FS/4, straight into the CORDIC's starting rotation
+		std::int32_t ci[BLOCK_SIZE];
+		std::int32_t cq[BLOCK_SIZE];
+		std::int32_t phase[BLOCK_SIZE];
+
+		for (int n = 0; n < count; n++) {
+			int p = (mix_phase + n + 1) & 3;
+			std::int16_t ii = acc_i[n] >> 15;
+			std::int16_t qq = acc_q[n] >> 15;
+
+			// {-qq, -ii, qq, ii} and {ii, -qq, -ii, qq}
+			std::int32_t i = static_cast<std::int16_t>((p & 1) ? ii : qq) * (p < 2 ? -1 : 1);
+			std::int32_t q = static_cast<std::int16_t>((p & 1) ? qq : ii) * ((p == 0 || p == 3) ? 1 : -1);
+
+			// rotate by an initial +/- 90 degrees
+			bool flip = i < 0;
+			bool up = q > 0;
+			ci[n] = flip ? (up ? q : -q) : i;
+			cq[n] = flip ? (up ? -i : i) : q;
+			phase[n] = flip ? (up ? -CORDIC_HALF_PI : CORDIC_HALF_PI) : 0;
+		}
+
+		// rotate using "1 + jK" factors
+		for (int idx = 0; idx <= CORDIC_ITERATIONS; idx++) {
+			const std::int32_t theta = CORDIC_THETAS[idx];
+
+			for (int n = 0; n < count; n++) {
+				std::int32_t i = ci[n];
+				std::int32_t q = cq[n];
+				bool positive = q >= 0;
+				ci[n] = i + (positive ? (q >> idx) : -(q >> idx));
+				cq[n] = q - (positive ? (i >> idx) : -(i >> idx));
+				phase[n] -= positive ? theta : -theta;
+			}
+		}
+
+		// phase difference is our frequency
+		std::int16_t freq[BLOCK_SIZE];
+		std::int16_t prev_phase = last_phase;
+		for (int n = 0; n < count; n++) {
+			std::int16_t cur_phase = phase[n];
+			std::int16_t tracked_frequency = prev_phase - cur_phase;
+			prev_phase = cur_phase;
+
+			freq[n] = (static_cast<std::int32_t>(tracked_frequency) * samplerate) >> 16;
+		}
+		last_phase = prev_phase;
+
+		// only the smoothing depends on the last sample
+		for (int n = 0; n < count; n++) {
+			smoothed_freq = ((smoothed_freq << 3) + freq[n] - smoothed_freq) >> 3;
+			out[n] = std::min(std::max(smoothed_freq, static_cast<std::uint32_t>(MIN_FREQ)), static_cast<std::uint32_t>(MAX_FREQ));
+		}
+
+		mix_phase = (mix_phase + count) & 3;
+		memmove(filter_i, filter_i + count, FILTER_HISTORY * sizeof(std::int16_t));
+		memmove(filter_q, filter_q + count, FILTER_HISTORY * sizeof(std::int16_t));
+	}
+
+} // namespace fasstv
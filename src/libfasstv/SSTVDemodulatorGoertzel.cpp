@@ -0,0 +1,83 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVDemodulator.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fasstv {
+
+	void GoertzelDemodulator::Reset() {
+		std::fill(history.begin(), history.end(), 0.f);
+	}
+
+	void GoertzelDemodulator::Setup(int samplerate) {
+		setup_samplerate = samplerate;
+		window = std::max(8, static_cast<int>(std::lround((WINDOW_MS / 1000.f) * samplerate)));
+
+		// Hann windowed, so a tone between bins falls off smoothly enough to interpolate
+		twiddle_re.resize(BINS * window);
+		twiddle_im.resize(BINS * window);
+		for (int b = 0; b < BINS; b++) {
+			float omega = (2.f * M_PIf * (900.f + (b * BIN_SPACING))) / samplerate;
+			for (int d = 0; d < window; d++) {
+				float hann = 0.5f - (0.5f * std::cos((2.f * M_PIf * (d + 0.5f)) / window));
+				twiddle_re[(d * BINS) + b] = hann * std::cos(omega * d);
+				twiddle_im[(d * BINS) + b] = hann * -std::sin(omega * d);
+			}
+		}
+
+		history.assign(window - 1, 0.f);
+	}
+
+	void GoertzelDemodulator::Process(const float* in, float* out, size_t count, int samplerate) {
+		if (samplerate != setup_samplerate)
+			Setup(samplerate);
+
+		std::vector<float> buf(history);
+		buf.insert(buf.end(), in, in + count);
+
+		for (size_t n = 0; n < count; n++) {
+			const float* x = &buf[n];
+
+			// every bin at once, sample by sample, so the inner loop runs across bins and vectorises
+			float re[BINS] {};
+			float im[BINS] {};
+			for (int d = 0; d < window; d++) {
+				const float* tr = &twiddle_re[d * BINS];
+				const float* ti = &twiddle_im[d * BINS];
+				for (int b = 0; b < BINS; b++) {
+					re[b] += x[d] * tr[b];
+					im[b] += x[d] * ti[b];
+				}
+			}
+
+			float power[BINS];
+			for (int b = 0; b < BINS; b++)
+				power[b] = (re[b] * re[b]) + (im[b] * im[b]);
+
+			int best = std::max_element(power, power + BINS) - power;
+			float freq = 900.f + (best * BIN_SPACING);
+
+			// fit a gaussian through the peak and its neighbours (a parabola on the log)
+			if (best > 0 && best < BINS - 1 && power[best] > 0.f) {
+				float l = std::log(power[best - 1] + 1e-20f);
+				float c = std::log(power[best]);
+				float r = std::log(power[best + 1] + 1e-20f);
+				float curve = l - (2.f * c) + r;
+				if (curve < 0.f)
+					freq += (0.5f * (l - r) / curve) * BIN_SPACING;
+			}
+
+			out[n] = std::clamp(freq, MIN_FREQ, MAX_FREQ);
+		}
+
+		history.assign(buf.end() - (window - 1), buf.end());
+	}
+
+	int GoertzelDemodulator::GetDelaySamples(int samplerate) const {
+		// the middle of the window
+		return std::max(8, static_cast<int>(std::lround((WINDOW_MS / 1000.f) * samplerate))) / 2;
+	}
+
+} // namespace fasstv
@@ -0,0 +1,75 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVDemodulator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace fasstv {
+
+	HilbertDemodulator::HilbertDemodulator() {
+		// ideal Hilbert transformer (2/pi*k on odd taps) under a Hamming window.
+		// stored back to front, so it runs forwards over the history
+		constexpr int center = TAPS / 2;
+		for (int i = 0; i < TAPS; i++) {
+			int k = center - i;
+			float window = 0.54f - (0.46f * std::cos((2.f * M_PIf * i) / (TAPS - 1)));
+			kernel[i] = (k % 2 != 0) ? (2.f / (M_PIf * k)) * window : 0.f;
+		}
+	}
+
+	void HilbertDemodulator::Reset() {
+		memset(history, 0, sizeof(history));
+		last_i = 0.f;
+		last_q = 0.f;
+		smoothed_freq = 0.f;
+	}
+
+	void HilbertDemodulator::Process(const float* in, float* out, size_t count, int samplerate) {
+		for (size_t done = 0; done < count; done += BLOCK_SIZE)
+			ProcessBlock(in + done, out + done, std::min<size_t>(BLOCK_SIZE, count - done), samplerate);
+	}
+
+	void HilbertDemodulator::ProcessBlock(const float* in, float* out, int count, int samplerate) {
+		float* new_samples = history + (TAPS - 1);
+		memcpy(new_samples, in, count * sizeof(float));
+
+		// quadrature from the filter, in phase is the same sample delayed to the filter's middle
+		float q[BLOCK_SIZE];
+		for (int n = 0; n < count; n++)
+			q[n] = 0.f;
+
+		for (int t = 0; t < TAPS; t++) {
+			if (kernel[t] == 0.f)
+				continue;
+
+			for (int n = 0; n < count; n++)
+				q[n] += history[n + t] * kernel[t];
+		}
+
+		// angle between this sample and the last on the unit circle is the frequency
+		const float to_hz = samplerate / (2.f * M_PIf);
+		for (int n = 0; n < count; n++) {
+			float i = history[n + (TAPS / 2)];
+			float re = (i * last_i) + (q[n] * last_q);
+			float im = (q[n] * last_i) - (i * last_q);
+			last_i = i;
+			last_q = q[n];
+
+			float freq = std::atan2(im, re) * to_hz;
+
+			// same smoothing as the CORDIC path
+			smoothed_freq += (freq - smoothed_freq) / 8.f;
+			out[n] = std::clamp(smoothed_freq, MIN_FREQ, MAX_FREQ);
+		}
+
+		memmove(history, history + count, (TAPS - 1) * sizeof(float));
+	}
+
+	int HilbertDemodulator::GetDelaySamples(int /*samplerate*/) const {
+		// half the filter, plus about as much again for the smoothing
+		return (TAPS / 2) + 7;
+	}
+
+} // namespace fasstv
@@ -0,0 +1,54 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVDemodulator.hpp>
+
+#include <algorithm>
+
+namespace fasstv {
+
+	void ZeroCrossingDemodulator::Reset() {
+		last_sample = 0.f;
+		since_crossing = 0.0;
+		std::fill(std::begin(half_periods), std::end(half_periods), 0.0);
+		next_half_period = 0;
+		crossings_seen = 0;
+		freq = MIN_FREQ;
+	}
+
+	void ZeroCrossingDemodulator::Process(const float* in, float* out, size_t count, int samplerate) {
+		for (size_t n = 0; n < count; n++) {
+			float sample = in[n];
+			since_crossing += 1.0;
+
+			if ((last_sample < 0.f) != (sample < 0.f)) {
+				// where between the last sample and this one it crossed
+				double after = sample / static_cast<double>(sample - last_sample);
+				double half_period = since_crossing - after;
+				since_crossing = after;
+
+				// the first crossing has nothing before it to measure from
+				if (crossings_seen++ > 0) {
+					half_periods[next_half_period] = half_period;
+					next_half_period = (next_half_period + 1) % HALF_PERIODS;
+				}
+
+				if (crossings_seen > HALF_PERIODS) {
+					double sum = 0.0;
+					for (double h : half_periods)
+						sum += h;
+
+					freq = (samplerate * HALF_PERIODS) / (2.0 * sum);
+				}
+			}
+
+			last_sample = sample;
+			out[n] = std::clamp(freq, MIN_FREQ, MAX_FREQ);
+		}
+	}
+
+	int ZeroCrossingDemodulator::GetDelaySamples(int samplerate) const {
+		// the estimate covers the last couple of cycles, call it one cycle at the middle of the range
+		return samplerate / 1900;
+	}
+
+} // namespace fasstv
@@ -30,7 +30,22 @@ namespace fasstv {
 		LogInfo("Setting SSTV encode mode to {}", mode->name);
 
 		current_mode = mode;
-		SSTV::CreateInstructions(instructions, mode);
+
+		std::vector<SSTV::LineBand> loop_bands;
+		if (!line_bands.empty())
+			loop_bands = SSTV::GetLoopBands(mode, line_bands);
+
+		SSTV::CreateInstructions(instructions, mode, true, &loop_bands);
+	}
+
+	void SSTVEncode::SetLineBands(const std::vector<SSTV::LineBand>& bands) {
+		line_bands = bands;
+
+		// rebuild with the new bands
+		if (current_mode != nullptr) {
+			SetMode(current_mode);
+			SetSampleRate(samplerate);
+		}
 	}
 
 	void SSTVEncode::SetSampleRate(int samplerate) {
@@ -56,6 +71,11 @@ namespace fasstv {
 		pixProviderFunc = cb;
 	}
 
+	void SSTVEncode::SetPlanarYUVSource(const PlanarYUV* yuv) {
+		// only used by YRYBY modes, everything else still goes through the pixel provider
+		yuvSource = yuv;
+	}
+
 	void SSTVEncode::SetInstructionTypeFilter(SSTV::InstructionType type, std::int8_t scan_id) {
 		filter_inst_type = type;
 		filter_scan_id = scan_id;
@@ -80,7 +100,15 @@ namespace fasstv {
 			*length_in_samples = this->estimated_length_in_samples;
 	}
 
+	int SSTVEncode::GetInstructionLength() const {
+		return static_cast<int>(std::floor(sample_carry + ((current_instruction->length_ms * samplerate) / 1000.0)));
+	}
+
 	bool SSTVEncode::GetNextInstruction() {
+		// whatever didn't fit in a whole sample goes on the next one, so the timing never drifts
+		double exact = sample_carry + ((current_instruction->length_ms * samplerate) / 1000.0);
+		sample_carry = exact - std::floor(exact);
+
 		last_instruction_sample = cur_sample;
 
 		if (current_instruction >= instructions.end().base() - 1)
@@ -94,6 +122,10 @@ namespace fasstv {
 		if(current_instruction->flags & SSTV::InstructionFlags::NewLine)
 			cur_y++;
 
+		// partial transmissions jump over the lines they don't send
+		if(current_instruction->type == SSTV::InstructionType::Skip)
+			cur_y += current_instruction->pitch;
+
 		/*if (current_instruction->flags & InstructionFlags::PitchUsesIndex) {
 			LogDebug("Pitch comes from index: {}, {}", current_instruction->pitch, current_mode->frequencies[current_instruction->pitch]);
 		}
@@ -126,18 +158,28 @@ namespace fasstv {
 			// RGBA8888 pixel
 			std::uint8_t* pixel = nullptr;
 
+			// YUV frames go straight onto the Y/R-Y/B-Y scans, skipping the RGB round trip
+			bool planar = yuvSource != nullptr && current_mode->scan_type == SSTV::YRYBY;
+			int sample_x = 0;
+			int sample_y = 0;
+
 			// calculate the sample to take when we're not drawing the letterbox
 			// otherwise, the nullptr is returned and the pattern will be drawn
 			if(!letterbox_sides && !letterbox_tops) {
 				// where we're at along our scanline
-				int sample_x = (rect.w - 1) * (std::max(cur_x - letterbox.x, 0) / (float)letterbox.w);
-				int sample_y = (rect.h - 1) * (std::max(cur_y - letterbox.y, 0) / (float)letterbox.h);
-
-				// get pixel at that sample
-				if (pixProviderFunc != nullptr)
-					pixel = pixProviderFunc(sample_x, sample_y);
-				else
-					LogError("Pixel provider is null!!!");
+				sample_x = (rect.w - 1) * (std::max(cur_x - letterbox.x, 0) / (float)letterbox.w);
+				sample_y = (rect.h - 1) * (std::max(cur_y - letterbox.y, 0) / (float)letterbox.h);
+
+				// get pixel at that sample (planar frames are read by the scan handler)
+				if (!planar) {
+					if (pixProviderFunc != nullptr)
+						pixel = pixProviderFunc(sample_x, sample_y);
+					else
+						LogError("Pixel provider is null!!!");
+				}
+			}
+			else {
+				planar = false;
 			}
 
 			switch (current_mode->scan_type) {
@@ -145,7 +187,10 @@ namespace fasstv {
 					pitch = ScanMonochrome(current_instruction, cur_x, cur_y, pixel);
 					break;
 				case SSTV::YRYBY:
-					pitch = ScanYRYBY(current_instruction, cur_x, cur_y, pixel);
+					if (planar)
+						pitch = ScanYRYBYPlanar(current_instruction, yuvSource, sample_x, sample_y);
+					else
+						pitch = ScanYRYBY(current_instruction, cur_x, cur_y, pixel);
 					break;
 				case SSTV::RGB:
 					pitch = ScanRGB(current_instruction, cur_x, cur_y, pixel);
@@ -167,6 +212,7 @@ namespace fasstv {
 	void SSTVEncode::ResetInstructionProcessing() {
 		cur_sample = 0;
 		last_instruction_sample = 0;
+		sample_carry = 0.0;
 		phase = 0;
 		cur_x = cur_y = 0;
 
@@ -192,7 +238,7 @@ namespace fasstv {
 		has_started = true;
 
 		for(size_t i = 0; i < arr_len; i++) {
-			int len_samples = current_instruction->length_ms / (timestep * 1000);
+			int len_samples = GetInstructionLength();
 
 			if (cur_sample >= last_instruction_sample + len_samples) {
 				if (!GetNextInstruction()) {
@@ -202,7 +248,7 @@ namespace fasstv {
 				}
 
 				// recalculate len_samples
-				len_samples = current_instruction->length_ms / (timestep * 1000);
+				len_samples = GetInstructionLength();
 			}
 
 			float widthfrac = ((float)(cur_sample - last_instruction_sample) / len_samples);
@@ -230,7 +276,7 @@ namespace fasstv {
 		has_started = true;
 
 		while(current_instruction < instructions.end().base()) {
-			int len_samples = current_instruction->length_ms / (timestep * 1000);
+			int len_samples = GetInstructionLength();
 
 			bool doFiltering = filter_inst_type != SSTV::InstructionType::InvalidInstructionType;
 			bool filter_correctType = current_instruction->type == filter_inst_type || filter_inst_type == SSTV::InstructionType::Any;
@@ -392,5 +438,37 @@ namespace fasstv {
 
 		return pitch;
 	}
+
+	float SSTVEncode::ScanYRYBYPlanar(SSTV::Instruction* ins, const PlanarYUV* yuv, int sample_x, int sample_y) {
+		if (ins == nullptr || yuv == nullptr)
+			return 1500.f;
+
+		int pass = std::clamp((int)ins->pitch, 0, 3); // modes 0-2 correspond to Y/R-Y/B-Y/A
+
+		// no alpha in YUV, so it's always opaque
+		if (pass == 3)
+			return 2300.f;
+
+		sample_x = std::clamp(sample_x, 0, yuv->width - 1);
+		sample_y = std::clamp(sample_y, 0, yuv->height - 1);
+
+		// R-Y is Cr (V), B-Y is Cb (U)
+		const int plane_for_pass[3] = {0, 2, 1};
+		int plane = plane_for_pass[pass];
+
+		int x = sample_x;
+		int y = sample_y;
+		if (plane != 0) {
+			// 4:2:0 chroma rows are shared by a pair of lines, which is exactly what
+			// a doubled scan sends - both lines of the pair land on the same chroma row
+			x >>= yuv->chroma_shift_x;
+			y >>= yuv->chroma_shift_y;
+		}
+
+		std::uint8_t value = yuv->planes[plane][(y * yuv->strides[plane]) + x];
+
+		// same mapping as ScanYRYBY, the value is already in the Y/R-Y/B-Y range
+		return 1500. + (value * 3.1372549);
+	}
 	
 } // namespace fasstv
\ No newline at end of file
@@ -0,0 +1,256 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVEncodeCache.hpp>
+
+#include <shared/Hasher.hpp>
+#include <shared/Logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fasstv {
+
+	// bump when the encoder output changes, so old renders aren't served
+	constexpr std::uint32_t CACHE_FORMAT_VERSION = 3;
+
+	constexpr char CACHE_MAGIC[4] = {'F', 'S', 'T', 'C'};
+
+	// at the start of every entry, so a hit can be checked against what was asked for before it's used
+	struct CacheEntryHeader {
+		char magic[4];
+		std::uint32_t version;
+		std::uint8_t digest[32];
+		std::uint64_t sample_count;
+	};
+
+	std::string SSTVEncodeCache::Key::ToString() const {
+		std::string out;
+		out.reserve(digest.size() * 2);
+		for (std::uint8_t byte : digest)
+			out += std::format("{:02x}", byte);
+
+		return out;
+	}
+
+	SSTVEncodeCache::MappedSamples::~MappedSamples() {
+		Unmap();
+	}
+
+	SSTVEncodeCache::MappedSamples::MappedSamples(MappedSamples&& other) noexcept {
+		*this = std::move(other);
+	}
+
+	SSTVEncodeCache::MappedSamples& SSTVEncodeCache::MappedSamples::operator=(MappedSamples&& other) noexcept {
+		if (this != &other) {
+			Unmap();
+			data = other.data;
+			size = other.size;
+			offset = other.offset;
+			other.data = nullptr;
+			other.size = 0;
+			other.offset = 0;
+		}
+
+		return *this;
+	}
+
+	void SSTVEncodeCache::MappedSamples::Unmap() {
+		if (data != nullptr)
+			munmap(data, size);
+
+		data = nullptr;
+		size = 0;
+		offset = 0;
+	}
+
+	SSTVEncodeCache::SSTVEncodeCache(std::filesystem::path directory, std::uint64_t max_size_bytes)
+		: directory(std::move(directory)), max_size_bytes(max_size_bytes) {
+		std::error_code ec;
+		std::filesystem::create_directories(this->directory, ec);
+		if (ec)
+			LogError("Couldn't create encode cache directory {}: {}", this->directory.string(), ec.message());
+	}
+
+	SSTVEncodeCache::Key SSTVEncodeCache::MakeKey(const std::uint8_t* pixels, int width, int height, int pitch, const EncodeParams& params) {
+		Hasher256 hasher;
+
+		hasher.Add(CACHE_FORMAT_VERSION);
+
+		hasher.Add(width);
+		hasher.Add(height);
+		for (int y = 0; y < height; y++)
+			hasher.Add(pixels + (y * pitch), width * 4);
+
+		// everything about the mode that changes the output, as modes can be resized or built at runtime
+		if (params.mode != nullptr) {
+			const SSTV::Mode* mode = params.mode;
+			hasher.Add(mode->name.data(), mode->name.size());
+			hasher.Add(mode->vis_code);
+			hasher.Add(mode->scan_type);
+			hasher.Add(mode->width);
+			hasher.Add(mode->lines);
+			hasher.Add(mode->uses_extra_lines);
+			hasher.Add(mode->timings.data(), mode->timings.size() * sizeof(float));
+			hasher.Add(mode->frequencies.data(), mode->frequencies.size() * sizeof(int));
+		}
+
+		hasher.Add(params.samplerate);
+		hasher.Add(params.volume);
+		hasher.Add(params.noise_strength);
+		for (const SSTV::LineBand& band : params.line_bands) {
+			hasher.Add(band.first);
+			hasher.Add(band.count);
+		}
+
+		return { hasher.Finish() };
+	}
+
+	std::filesystem::path SSTVEncodeCache::GetPath(const Key& key) const {
+		return directory / (key.ToString() + ".pcm");
+	}
+
+	bool SSTVEncodeCache::Lookup(const Key& key, MappedSamples& out) {
+		std::filesystem::path path = GetPath(key);
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			stats.misses++;
+			return false;
+		}
+
+		struct stat st {};
+		if (fstat(fd, &st) != 0 || st.st_size <= static_cast<off_t>(sizeof(CacheEntryHeader))) {
+			close(fd);
+			stats.misses++;
+			return false;
+		}
+
+		void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (data == MAP_FAILED) {
+			LogError("Couldn't map cached samples {}", path.string());
+			stats.misses++;
+			return false;
+		}
+
+		// a truncated, foreign or colliding entry is a miss, and gets written over by the next store
+		CacheEntryHeader header {};
+		memcpy(&header, data, sizeof(header));
+
+		size_t sample_bytes = st.st_size - sizeof(CacheEntryHeader);
+		if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_FORMAT_VERSION || memcmp(header.digest, key.digest.data(), key.digest.size()) != 0 ||
+		    sample_bytes % sizeof(float) != 0 || sample_bytes / sizeof(float) != header.sample_count) {
+			LogWarning("Cached samples {} don't match what they're filed under, ignoring them", path.string());
+			munmap(data, st.st_size);
+			stats.misses++;
+			return false;
+		}
+
+		madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+		out.Unmap();
+		out.data = data;
+		out.size = st.st_size;
+		out.offset = sizeof(CacheEntryHeader);
+
+		// mark as recently used for eviction
+		std::error_code ec;
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+		stats.hits++;
+		return true;
+	}
+
+	bool SSTVEncodeCache::Store(const Key& key, std::span<const float> samples) {
+		std::filesystem::path path = GetPath(key);
+		std::filesystem::path temp_path = path;
+		temp_path += std::format(".{}.tmp", getpid());
+
+		CacheEntryHeader header {};
+		memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		header.version = CACHE_FORMAT_VERSION;
+		memcpy(header.digest, key.digest.data(), key.digest.size());
+		header.sample_count = samples.size();
+
+		std::error_code ec;
+
+		// write then rename, so nobody maps a half-written file
+		{
+			std::ofstream file(temp_path, std::ios::binary);
+			if (!file) {
+				LogError("Couldn't write to encode cache {}", temp_path.string());
+				return false;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(samples.data()), samples.size_bytes());
+			file.close();
+
+			// a full disk shows up here, and a short file must never be renamed into place
+			if (!file) {
+				LogError("Couldn't finish writing to encode cache {}", temp_path.string());
+				std::filesystem::remove(temp_path, ec);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temp_path, path, ec);
+		if (ec) {
+			LogError("Couldn't move {} into the encode cache: {}", temp_path.string(), ec.message());
+			std::filesystem::remove(temp_path, ec);
+			return false;
+		}
+
+		stats.stores++;
+
+		Evict();
+		return true;
+	}
+
+	void SSTVEncodeCache::Evict() {
+		struct Entry {
+			std::filesystem::path path;
+			std::uintmax_t size;
+			std::filesystem::file_time_type last_used;
+		};
+
+		std::vector<Entry> entries;
+		std::uintmax_t total_size = 0;
+
+		std::error_code ec;
+		for (const auto& dirent : std::filesystem::directory_iterator(directory, ec)) {
+			if (!dirent.is_regular_file() || dirent.path().extension() != ".pcm")
+				continue;
+
+			Entry entry { dirent.path(), dirent.file_size(ec), dirent.last_write_time(ec) };
+			total_size += entry.size;
+			entries.push_back(std::move(entry));
+		}
+
+		if (total_size <= max_size_bytes)
+			return;
+
+		// least recently used first
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+
+		for (const Entry& entry : entries) {
+			if (total_size <= max_size_bytes)
+				break;
+
+			// mapped copies stay valid after removal
+			if (std::filesystem::remove(entry.path, ec)) {
+				total_size -= entry.size;
+				stats.evictions++;
+			}
+		}
+	}
+
+} // namespace fasstv
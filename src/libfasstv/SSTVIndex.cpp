@@ -0,0 +1,190 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVIndex.hpp>
+
+#include <shared/Hasher.hpp>
+#include <shared/Logger.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace fasstv {
+
+	constexpr char INDEX_MAGIC[4] = {'F', 'S', 'T', 'I'};
+	// bump when the layout changes, old indexes just get rebuilt
+	constexpr std::uint32_t INDEX_FORMAT_VERSION = 3;
+
+	// how much of the recording goes into its hash
+	constexpr size_t HASH_EDGE_BYTES = 1 << 20;
+	constexpr size_t HASH_PAGE_BYTES = 4096;
+	constexpr size_t HASH_PAGES = 256;
+
+	template <typename T>
+	void index_write(std::ofstream& file, T num) {
+		file.write(reinterpret_cast<const char*>(&num), sizeof(T));
+	}
+
+	template <typename T>
+	bool index_read(std::ifstream& file, T& num) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&num), sizeof(T)));
+	}
+
+	SSTVIndex::RecordingHash SSTVIndex::HashRecording(std::span<const std::uint8_t> file_bytes) {
+		Hasher256 hasher;
+
+		std::uint64_t size = file_bytes.size();
+		hasher.Add(size);
+
+		// headers up front, trailing chunks at the back, and pages spread out over the middle
+		size_t edge = std::min(HASH_EDGE_BYTES, file_bytes.size());
+		hasher.Add(file_bytes.data(), edge);
+		hasher.Add(file_bytes.data() + file_bytes.size() - edge, edge);
+
+		if (file_bytes.size() > HASH_PAGE_BYTES) {
+			size_t stride = (file_bytes.size() - HASH_PAGE_BYTES) / HASH_PAGES;
+			for (size_t i = 0; i < HASH_PAGES && stride > 0; i++)
+				hasher.Add(file_bytes.data() + (i * stride), HASH_PAGE_BYTES);
+		}
+
+		// half of it is plenty to tell recordings apart
+		Hasher256::Digest digest = hasher.Finish();
+		RecordingHash hash {};
+		memcpy(hash.hash, digest.data(), sizeof(hash.hash));
+		return hash;
+	}
+
+	std::filesystem::path SSTVIndex::GetSidecarPath(const std::filesystem::path& recording) {
+		std::filesystem::path path = recording;
+		path += ".fstidx";
+		return path;
+	}
+
+	bool SSTVIndex::Save(const std::filesystem::path& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			LogError("Couldn't write index {}", path.string());
+			return false;
+		}
+
+		file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		index_write<std::uint32_t>(file, INDEX_FORMAT_VERSION);
+		index_write<std::uint64_t>(file, recording_hash.hash[0]);
+		index_write<std::uint64_t>(file, recording_hash.hash[1]);
+		index_write<std::uint32_t>(file, samplerate);
+		index_write<std::uint64_t>(file, sample_count);
+		index_write<std::uint32_t>(file, transmissions.size());
+
+		for (const SSTVScanner::Transmission& transmission : transmissions) {
+			index_write<std::uint64_t>(file, transmission.start_smp);
+			index_write<std::uint32_t>(file, transmission.length_smp);
+			index_write<std::uint8_t>(file, transmission.vis_code);
+
+			// parametric VIS codes don't say which mode on their own
+			if (SSTV::IsParametricVIS(transmission.vis_code)) {
+				SSTV::ParametricModeParams params {};
+				SSTV::GetParametricParams(transmission.mode, params);
+				index_write<std::uint16_t>(file, params.width);
+				index_write<std::uint16_t>(file, params.lines);
+				index_write<float>(file, params.pixel_dwell_us);
+			}
+
+			index_write<float>(file, transmission.skew_ppm);
+			index_write<std::uint32_t>(file, transmission.sync_offsets.size());
+			file.write(reinterpret_cast<const char*>(transmission.sync_offsets.data()), transmission.sync_offsets.size() * sizeof(std::int16_t));
+		}
+
+		if (!file) {
+			LogError("Couldn't finish writing index {}", path.string());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool SSTVIndex::Load(const std::filesystem::path& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		file.seekg(0, std::ios::end);
+		std::streamoff file_size = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		char magic[4] {};
+		std::uint32_t version = 0;
+		if (!file.read(magic, sizeof(magic)) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 || !index_read(file, version) || version != INDEX_FORMAT_VERSION) {
+			LogWarning("{} isn't an index we can read", path.string());
+			return false;
+		}
+
+		std::uint32_t rate = 0, count = 0;
+		if (!index_read(file, recording_hash.hash[0]) || !index_read(file, recording_hash.hash[1]) || !index_read(file, rate) || !index_read(file, sample_count) || !index_read(file, count)) {
+			LogWarning("Index {} is truncated", path.string());
+			return false;
+		}
+
+		samplerate = rate;
+		transmissions.clear();
+		// every transmission takes more than a byte, so that's as many as there can be
+		transmissions.reserve(std::min<std::streamoff>(count, file_size - file.tellg()));
+
+		for (std::uint32_t i = 0; i < count; i++) {
+			SSTVScanner::Transmission transmission {};
+			std::uint64_t start = 0;
+			std::uint32_t length = 0, syncs = 0;
+
+			if (!index_read(file, start) || !index_read(file, length) || !index_read(file, transmission.vis_code)) {
+				LogWarning("Index {} is truncated", path.string());
+				return false;
+			}
+
+			if (SSTV::IsParametricVIS(transmission.vis_code)) {
+				SSTV::ParametricModeParams params {};
+				params.layout = static_cast<SSTV::ParametricLayout>(transmission.vis_code - SSTV::PARAMETRIC_VIS_FIRST);
+				if (!index_read(file, params.width) || !index_read(file, params.lines) || !index_read(file, params.pixel_dwell_us)) {
+					LogWarning("Index {} is truncated", path.string());
+					return false;
+				}
+
+				// zeroes if the header couldn't be read when it was scanned, which makes no mode
+				if (params.width != 0)
+					transmission.mode = SSTV::CreateParametricMode(params);
+			}
+			else {
+				transmission.mode = SSTV::GetMode(transmission.vis_code);
+			}
+
+			if (!index_read(file, transmission.skew_ppm) || !index_read(file, syncs)) {
+				LogWarning("Index {} is truncated", path.string());
+				return false;
+			}
+
+			if (start >= sample_count) {
+				LogWarning("Index {} has a transmission past the end of the recording", path.string());
+				return false;
+			}
+
+			transmission.start_smp = static_cast<std::int64_t>(start);
+			transmission.length_smp = length;
+
+			// at most a sync per line plus Scottie's leading one, and never more than the file still holds
+			std::uint32_t max_syncs = transmission.mode != nullptr ? transmission.mode->lines + 1u : 0u;
+			if (syncs > max_syncs || static_cast<std::streamoff>(syncs * sizeof(std::int16_t)) > file_size - file.tellg()) {
+				LogWarning("Index {} has more syncs than its transmission can have", path.string());
+				return false;
+			}
+
+			transmission.sync_offsets.resize(syncs);
+			if (!file.read(reinterpret_cast<char*>(transmission.sync_offsets.data()), syncs * sizeof(std::int16_t))) {
+				LogWarning("Index {} is truncated", path.string());
+				return false;
+			}
+
+			transmissions.push_back(std::move(transmission));
+		}
+
+		return true;
+	}
+
+} // namespace fasstv
@@ -0,0 +1,232 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVLineDetector.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fasstv {
+
+	constexpr float BIN_MS = 0.5f;             // the track's averaged down to this before anything looks at it
+	constexpr int MIN_LOOPS = 4;               // how many loops of the longest mode have to be heard before one can be picked
+	constexpr int WINDOW_LOOPS = 8;            // and the most that get looked at
+	constexpr float EDGE_TRIM_MS = 1.f;        // the demodulator smears every edge about this much, so segments keep clear of them
+	constexpr float SYNC_TOP_FREQ = 1500.f;    // a bin counts as sync the further below this it is
+	constexpr float SYNC_RANGE = 300.f;        // all the way down at 1200Hz
+	constexpr float MIN_SYNC_CORRELATION = 0.4f;
+	constexpr float MAX_ERROR_HZ = 100.f;
+	constexpr float MIN_SCAN_FREQ = 1350.f;    // scans never go below black (1500Hz), and folded over a few loops nothing in them gets near a sync either
+
+	SSTVLineDetector::SSTVLineDetector(int samplerate, SSTV::Mode* only_mode /*= nullptr*/) : samplerate(samplerate) {
+		if (only_mode != nullptr) {
+			AddTemplate(only_mode);
+		}
+		else {
+			for (auto& mode : SSTV::The().MODES)
+				AddTemplate(&mode);
+
+			std::lock_guard lock(SSTV::The().PARAMETRIC_MUTEX);
+			for (auto& mode : SSTV::The().PARAMETRIC_MODES)
+				AddTemplate(&mode);
+		}
+
+		float longest_ms = 0.f;
+		for (const Template& tmpl : templates)
+			longest_ms = std::max(longest_ms, tmpl.loop_ms);
+
+		min_samples = static_cast<int>(std::ceil(((longest_ms * MIN_LOOPS) / 1000.f) * samplerate));
+		window_samples = static_cast<int>(std::ceil(((longest_ms * WINDOW_LOOPS) / 1000.f) * samplerate));
+	}
+
+	void SSTVLineDetector::AddTemplate(SSTV::Mode* mode) {
+		Template tmpl { mode, 0.f, 0.f, {} };
+		int syncs = 0;
+
+		// one loop, just as SSTV::CreateInstructions would send it
+		for (size_t i = mode->instruction_loop_start; i < mode->instructions_looping.size(); i++) {
+			const SSTV::Instruction& ins = mode->instructions_looping[i];
+			if (!mode->uses_extra_lines && ins.flags & SSTV::InstructionFlags::ExtraLine)
+				continue;
+
+			float length_ms = ins.flags & SSTV::InstructionFlags::LengthUsesIndex ? mode->timings[ins.length_ms] : ins.length_ms;
+
+			// scans are whatever the picture is, they're only checked for not looking like syncs
+			if (ins.type == SSTV::InstructionType::Scan || ins.flags & SSTV::InstructionFlags::PitchIsDelegated) {
+				tmpl.segments.push_back({ tmpl.loop_ms, length_ms, 0.f });
+			}
+			else {
+				float freq = ins.flags & SSTV::InstructionFlags::PitchUsesIndex ? mode->frequencies[ins.pitch] : ins.pitch;
+				if (length_ms - (2.f * EDGE_TRIM_MS) >= BIN_MS)
+					tmpl.segments.push_back({ tmpl.loop_ms + EDGE_TRIM_MS, length_ms - (2.f * EDGE_TRIM_MS), freq });
+
+				if (ins.type == SSTV::InstructionType::Sync && freq == SSTV::The().VIS_FREQS[0])
+					syncs++;
+			}
+
+			tmpl.loop_ms += length_ms;
+		}
+
+		// nothing to line up against
+		bool has_tones = std::any_of(tmpl.segments.begin(), tmpl.segments.end(), [](const Segment& seg) { return seg.freq > 0.f; });
+		if (syncs == 0 || !has_tones || tmpl.loop_ms <= 0.f)
+			return;
+
+		tmpl.sync_period_ms = tmpl.loop_ms / syncs;
+		templates.push_back(std::move(tmpl));
+	}
+
+	bool SSTVLineDetector::Detect(std::span<const float> freq, int start_smp, Result& result) const {
+		// every mode gets the same newest stretch to go on, otherwise short ones get picked
+		// before long ones could've been, off whatever came before the lines
+		if (static_cast<int>(freq.size()) < min_samples)
+			return false;
+
+		const double bin_smp = (BIN_MS / 1000.0) * samplerate;
+		const int bin_count = static_cast<int>(freq.size() / bin_smp);
+
+		// averaged down, and how sync-like each bin is
+		std::vector<float> bins(bin_count);
+		std::vector<float> sync(bin_count);
+		double sync_mean = 0.0;
+		for (int k = 0; k < bin_count; k++) {
+			size_t from = std::lround(k * bin_smp);
+			size_t to = std::max(from + 1, static_cast<size_t>(std::lround((k + 1) * bin_smp)));
+
+			float sum = 0.f;
+			for (size_t i = from; i < to; i++)
+				sum += freq[i];
+
+			bins[k] = sum / (to - from);
+			sync[k] = std::clamp((SYNC_TOP_FREQ - bins[k]) / SYNC_RANGE, 0.f, 1.f);
+			sync_mean += sync[k];
+		}
+
+		sync_mean /= bin_count;
+		for (float& s : sync)
+			s -= sync_mean;
+
+		const Template* best = nullptr;
+		float best_error = MAX_ERROR_HZ;
+		int best_phase = 0;
+
+		for (const Template& tmpl : templates) {
+			// the syncs have to actually repeat at this mode's line period
+			if (SyncCorrelation(sync, tmpl.sync_period_ms / BIN_MS) < MIN_SYNC_CORRELATION)
+				continue;
+
+			float error = 0.f;
+			int phase = 0;
+			if (!MatchTemplate(bins, tmpl, error, phase))
+				continue;
+
+			// modes with the same timing (Martin 1 and 3, say) can't be told apart, the first listed wins
+			if (error < best_error) {
+				best = &tmpl;
+				best_error = error;
+				best_phase = phase;
+			}
+		}
+
+		if (best == nullptr)
+			return false;
+
+		result.mode = best->mode;
+		result.loop_smp = (best->loop_ms / 1000.0) * samplerate;
+
+		// back to the first whole loop there is
+		result.loop_start_smp = std::fmod(best_phase * bin_smp, result.loop_smp);
+		result.loop_start_smp += start_smp;
+		result.error_hz = best_error;
+		return true;
+	}
+
+	float SSTVLineDetector::SyncCorrelation(const std::vector<float>& sync, float period_bins) const {
+		// normalised, at a fractional lag
+		const int lag = static_cast<int>(period_bins);
+		const float frac = period_bins - lag;
+		const int count = static_cast<int>(sync.size()) - lag - 1;
+		if (count <= 0)
+			return 0.f;
+
+		double cross = 0.0, energy = 0.0, energy_lagged = 0.0;
+		for (int k = 0; k < count; k++) {
+			float lagged = (sync[k + lag] * (1.f - frac)) + (sync[k + lag + 1] * frac);
+			cross += sync[k] * lagged;
+			energy += sync[k] * sync[k];
+			energy_lagged += lagged * lagged;
+		}
+
+		if (energy <= 0.0 || energy_lagged <= 0.0)
+			return 0.f;
+
+		return cross / std::sqrt(energy * energy_lagged);
+	}
+
+	bool SSTVLineDetector::MatchTemplate(const std::vector<float>& bins, const Template& tmpl, float& error_hz, int& phase_bin) const {
+		// fold the last few whole loops over each other, the picture averages out and the syncs and porches stay put.
+		// the newest ones, whatever came before the lines (silence, the header, another picture) would only smear them
+		const int phases = std::max(1, static_cast<int>(std::lround(tmpl.loop_ms / BIN_MS)));
+		const int loops = std::min(static_cast<int>((bins.size() * BIN_MS) / tmpl.loop_ms), WINDOW_LOOPS);
+		const int used_bins = static_cast<int>((loops * tmpl.loop_ms) / BIN_MS);
+		const int first_bin = static_cast<int>(bins.size()) - used_bins;
+
+		std::vector<float> folded(phases, 0.f);
+		std::vector<int> counts(phases, 0);
+		for (int k = 0; k < used_bins; k++) {
+			int phase = std::min(static_cast<int>(std::fmod(k * BIN_MS, tmpl.loop_ms) / BIN_MS), phases - 1);
+			folded[phase] += bins[first_bin + k];
+			counts[phase]++;
+		}
+
+		for (int p = 0; p < phases; p++)
+			folded[p] = counts[p] > 0 ? folded[p] / counts[p] : 0.f;
+
+		// every bin a tone should be at, as an offset from the start of the loop
+		std::vector<std::pair<int, float>> tones;
+		for (const Segment& seg : tmpl.segments) {
+			if (seg.freq <= 0.f)
+				continue;
+
+			int first = static_cast<int>(std::lround(seg.start_ms / BIN_MS));
+			int count = std::max(1, static_cast<int>(std::lround(seg.length_ms / BIN_MS)));
+			for (int j = 0; j < count; j++)
+				tones.push_back({ first + j, seg.freq });
+		}
+
+		float best_error = INFINITY;
+		int best_phase = 0;
+		for (int p = 0; p < phases; p++) {
+			float error = 0.f;
+			for (const auto& [offset, freq] : tones)
+				error += std::abs(folded[(p + offset) % phases] - freq);
+
+			if (error < best_error) {
+				best_error = error;
+				best_phase = p;
+			}
+		}
+
+		best_error /= tones.size();
+		if (best_error >= MAX_ERROR_HZ)
+			return false;
+
+		// lined up right, nothing in the scans should look like a sync. anywhere, a mode whose loop is a few
+		// of another's lines long folds the other's syncs on top of each other, and they'd hide in an average
+		for (const Segment& seg : tmpl.segments) {
+			if (seg.freq > 0.f)
+				continue;
+
+			int first = static_cast<int>(std::lround((seg.start_ms + EDGE_TRIM_MS) / BIN_MS));
+			int count = static_cast<int>(std::lround((seg.length_ms - (2.f * EDGE_TRIM_MS)) / BIN_MS));
+			for (int j = 0; j < count; j++) {
+				if (folded[(best_phase + first + j) % phases] < MIN_SCAN_FREQ)
+					return false;
+			}
+		}
+
+		error_hz = best_error;
+		phase_bin = first_bin + best_phase;
+		return true;
+	}
+
+} // namespace fasstv
@@ -4,11 +4,13 @@
 
 #include <shared/Logger.hpp>
 
+#include <algorithm>
 #include <math.h>
 
 namespace fasstv {
 
-	std::vector<SSTVMetadata::PerModeMetadata> SSTVMetadata::per_mode_metadata {};
+	std::deque<SSTVMetadata::PerModeMetadata> SSTVMetadata::per_mode_metadata {};
+	std::mutex SSTVMetadata::metadata_mutex {};
 
 	float SSTVMetadata::mode_longest_ms = 0.f;
 	float SSTVMetadata::mode_shortest_ms = MAXFLOAT;
@@ -78,6 +80,39 @@ namespace fasstv {
 			total_length_ms += length_ms;
 		}
 
+		// the full transmission, header and footer included. the encoder rounds each
+		// instruction to whole samples, so keep the lengths around to do the same
+		std::vector<SSTV::Instruction> transmission;
+		SSTV::CreateInstructions(transmission, mode);
+
+		float transmission_length_ms = 0.0f;
+		std::vector<InstructionLength> instruction_lengths;
+
+		for (auto& ins : transmission) {
+			transmission_length_ms += ins.length_ms;
+
+			auto it = std::find_if(instruction_lengths.begin(), instruction_lengths.end(), [&](const InstructionLength& il) { return il.length_ms == ins.length_ms; });
+			if (it != instruction_lengths.end())
+				it->count++;
+			else
+				instruction_lengths.push_back({ins.length_ms, 1});
+		}
+
+		float pixels_per_second = (mode->width * mode->lines) / (transmission_length_ms / 1000.f);
+
+		//LogDebug("Mode {}", mode->name);
+		//LogDebug("    Total length: {}s", total_length_ms / 1000.f);
+		//LogDebug("    Loop length: {}s", loop_length_ms / 1000.f);
+
+		// only the bookkeeping is locked, building the instructions can take the parametric mode lock
+		std::lock_guard lock(metadata_mutex);
+
+		// already done
+		for (auto& modemeta : per_mode_metadata) {
+			if (modemeta.mode == mode)
+				return;
+		}
+
 		if (total_length_ms > mode_longest_ms) {
 			mode_longest_ms = total_length_ms;
 			mode_longest = mode;
@@ -87,11 +122,7 @@ namespace fasstv {
 			mode_shortest = mode;
 		}
 
-		//LogDebug("Mode {}", mode->name);
-		//LogDebug("    Total length: {}s", total_length_ms / 1000.f);
-		//LogDebug("    Loop length: {}s", loop_length_ms / 1000.f);
-
-		per_mode_metadata.emplace_back(mode, total_length_ms, loop_length_ms, 0);
+		per_mode_metadata.emplace_back(mode, total_length_ms, loop_length_ms, 0, transmission_length_ms, pixels_per_second, std::move(instruction_lengths));
 	}
 
 	void SSTVMetadata::BuildMetadata() {
@@ -99,11 +130,21 @@ namespace fasstv {
 			ProcessMetadata(&mode);
 		}
 
+		// parametric modes get theirs as they're created
 		LogDebug("Longest mode is {} at {}s", mode_longest ? mode_longest->name : "(null)", mode_longest_ms / 1000.f);
 		LogDebug("Shortest mode is {} at {}s", mode_shortest ? mode_shortest->name : "(null)", mode_shortest_ms / 1000.f);
 	}
 
+	void SSTVMetadata::AddModeMetadata(SSTV::Mode* mode) {
+		if (mode != nullptr)
+			ProcessMetadata(mode);
+	}
+
 	SSTVMetadata::PerModeMetadata* SSTVMetadata::GetModeMetadata(SSTV::Mode* mode) {
+		if (mode == nullptr)
+			return nullptr;
+
+		std::lock_guard lock(metadata_mutex);
 		for(auto& modemeta : per_mode_metadata) {
 			if (modemeta.mode == mode)
 				return &modemeta;
@@ -112,4 +153,47 @@ namespace fasstv {
 		return nullptr;
 	}
 
+	SSTV::Mode* SSTVMetadata::SelectModeForAirtime(float budget_ms, const ModeConstraints& constraints) {
+		PerModeMetadata* best = nullptr;
+
+		std::lock_guard lock(metadata_mutex);
+		for (auto& modemeta : per_mode_metadata) {
+			SSTV::Mode* mode = modemeta.mode;
+
+			if (modemeta.transmission_length_ms > budget_ms)
+				continue;
+			if (mode->width < constraints.min_width || mode->lines < constraints.min_lines)
+				continue;
+			// sweeps are test patterns, they don't carry an image in any color
+			if (constraints.require_color && (mode->scan_type == SSTV::ScanType::Monochrome || mode->scan_type == SSTV::ScanType::Sweep))
+				continue;
+
+			// most pixels per second wins, ties go to the bigger image
+			if (best == nullptr || modemeta.pixels_per_second > best->pixels_per_second ||
+			    (modemeta.pixels_per_second == best->pixels_per_second && mode->width * mode->lines > best->mode->width * best->mode->lines))
+				best = &modemeta;
+		}
+
+		if (best == nullptr) {
+			LogDebug("No mode fits in {}s", budget_ms / 1000.f);
+			return nullptr;
+		}
+
+		return best->mode;
+	}
+
+	std::uint32_t SSTVMetadata::GetLengthInSamples(SSTV::Mode* mode, int samplerate) {
+		PerModeMetadata* modemeta = GetModeMetadata(mode);
+		if (modemeta == nullptr)
+			return 0;
+
+		// the encoder carries whatever doesn't fit in a whole sample over to the next instruction,
+		// so all it ever drops is the fraction left at the very end
+		double exact = 0.0;
+		for (auto& il : modemeta->instruction_lengths)
+			exact += il.count * ((il.length_ms * samplerate) / 1000.0);
+
+		return static_cast<std::uint32_t>(std::floor(exact));
+	}
+
 } // namespace fasstv
\ No newline at end of file
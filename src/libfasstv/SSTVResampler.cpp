@@ -0,0 +1,103 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVResampler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+namespace fasstv {
+
+	SSTVResampler::SSTVResampler(int in_samplerate, int out_samplerate)
+		: in_samplerate(in_samplerate), out_samplerate(out_samplerate) {
+		if (IsPassthrough())
+			return;
+
+		// the band has to be gone by half of whichever rate is lower, the rest can roll off however it likes
+		const double stop_hz = std::min(in_samplerate, out_samplerate) / 2.0;
+		const double pass_hz = std::min<double>(PASSBAND_HZ, stop_hz * 0.8);
+		const double cutoff = ((pass_hz + stop_hz) / 2.0) / in_samplerate; // cycles per input sample
+
+		// blackman needs about 5.5 over the transition width (as a fraction of the rate) for ~74dB
+		const int span = std::max(2, static_cast<int>(std::ceil((5.5 * in_samplerate) / (stop_hz - pass_hz))));
+		taps = ((span + LANES - 1) / LANES) * LANES;
+
+		// one phase per place an output can land between two inputs, if that's not too many
+		phases = std::min(out_samplerate / std::gcd(in_samplerate, out_samplerate), MAX_PHASES);
+
+		// the output's filtered around span/2 samples before the newest input it reads
+		const double half_span = span / 2.0;
+		delay_samples = static_cast<int>(std::lround(half_span * out_samplerate / in_samplerate));
+
+		coeffs.assign(static_cast<size_t>(phases) * taps, 0.f);
+		for (int p = 0; p < phases; p++) {
+			const double mu = p / static_cast<double>(phases);
+			float* c = &coeffs[static_cast<size_t>(p) * taps];
+
+			double sum = 0.0;
+			for (int j = 0; j < taps; j++) {
+				// distance from the middle of the filter, in input samples
+				double u = (taps - 1 - j) + mu - half_span;
+				if (std::abs(u) > half_span)
+					continue;
+
+				double x = 2.0 * cutoff * u;
+				double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+				double w = (u + half_span) / span;
+				double blackman = 0.42 - (0.5 * std::cos(2.0 * M_PI * w)) + (0.08 * std::cos(4.0 * M_PI * w));
+
+				c[j] = static_cast<float>(sinc * blackman);
+				sum += c[j];
+			}
+
+			// unity gain whatever the phase
+			for (int j = 0; j < taps; j++)
+				c[j] = static_cast<float>(c[j] / sum);
+		}
+
+		buffer.assign(taps - 1, 0.f);
+		next_smp = taps - 1;
+		next_frac = 0;
+	}
+
+	void SSTVResampler::Process(std::span<const float> in, std::vector<float>& out) {
+		if (IsPassthrough()) {
+			out.insert(out.end(), in.begin(), in.end());
+			return;
+		}
+
+		buffer.insert(buffer.end(), in.begin(), in.end());
+
+		const int available = static_cast<int>(buffer.size());
+		out.reserve(out.size() + ((in.size() * out_samplerate) / in_samplerate) + 1);
+
+		while (next_smp < available) {
+			const int phase = static_cast<int>((static_cast<std::int64_t>(next_frac) * phases) / out_samplerate);
+			const float* c = &coeffs[static_cast<size_t>(phase) * taps];
+			const float* x = &buffer[next_smp - (taps - 1)];
+
+			// a lane per accumulator, so nothing has to be reordered to vectorise
+			float acc[LANES] {};
+			for (int j = 0; j < taps; j += LANES) {
+				for (int l = 0; l < LANES; l++)
+					acc[l] += c[j + l] * x[j + l];
+			}
+
+			float sum = 0.f;
+			for (int l = 0; l < LANES; l++)
+				sum += acc[l];
+			out.push_back(sum);
+
+			next_frac += in_samplerate;
+			next_smp += next_frac / out_samplerate;
+			next_frac %= out_samplerate;
+		}
+
+		// keep just enough for the next output to reach back over
+		const int drop = available - (taps - 1);
+		buffer.erase(buffer.begin(), buffer.begin() + drop);
+		next_smp -= drop;
+	}
+
+} // namespace fasstv
@@ -0,0 +1,478 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVScanner.hpp>
+#include <libfasstv/SSTVDecode.hpp>
+#include <libfasstv/SSTVMetadata.hpp>
+#include <libfasstv/SSTVStartDetector.hpp>
+
+#include <shared/Logger.hpp>
+#include <shared/ThreadPool.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fasstv {
+
+	// decode a bit around each transmission
+	constexpr float SLICE_LEAD_SECONDS = 0.25f;
+	constexpr float SLICE_TAIL_SECONDS = 0.5f;
+
+	// how far either side of the last sync to look for the next one
+	constexpr float SYNC_SEARCH_MS = 2.f;
+	// below this fraction of the average sync power, the pulse is too buried to trust
+	constexpr float SYNC_MIN_POWER_RATIO = 0.25f;
+	// heard syncs it takes before the skew is worth handing to the decoder
+	constexpr int SYNC_MIN_FOR_SKEW = 16;
+
+	// samples read at a time when scanning through a reader
+	constexpr std::int64_t SCAN_WINDOW = 1 << 16;
+
+	float VISGoertzelPower(std::span<const float> samples, float freq, int samplerate) {
+		float coeff = 2.f * std::cos(2.f * M_PIf * freq / samplerate);
+		float s1 = 0.f, s2 = 0.f;
+		for (float smp : samples) {
+			float s0 = smp + (coeff * s1) - s2;
+			s2 = s1;
+			s1 = s0;
+		}
+
+		return (s1 * s1) + (s2 * s2) - (coeff * s1 * s2);
+	}
+
+	bool ReadHeaderBit(std::span<const float> samples, int samplerate, std::int64_t bit_start, bool& bit) {
+		SSTV& sstv = SSTV::The();
+
+		int bit_smp = (sstv.VIS_LENGTHS_MS[1] / 1000.f) * samplerate;
+
+		// only listen to the middle of each bit, in case we're off by a little
+		int margin_smp = bit_smp / 6;
+		std::int64_t from = bit_start + margin_smp;
+		std::int64_t to = bit_start + bit_smp - margin_smp;
+
+		if (from < 0 || to > static_cast<std::int64_t>(samples.size()))
+			return false;
+
+		std::span<const float> window = samples.subspan(from, to - from);
+		bit = VISGoertzelPower(window, sstv.VIS_BIT_FREQS[1], samplerate) > VISGoertzelPower(window, sstv.VIS_BIT_FREQS[0], samplerate);
+		return true;
+	}
+
+	// where the first VIS bit (after the leaders, break and start bit) starts, from the start of the leader
+	float GetFirstVISBitMs() {
+		SSTV& sstv = SSTV::The();
+		return (sstv.VIS_LENGTHS_MS[2] * 2) + sstv.VIS_LENGTHS_MS[0] + sstv.VIS_LENGTHS_MS[1];
+	}
+
+	// where a band header would start, from the start of the leader. right after the VIS stop bit, or the parametric header's
+	float GetBandHeaderMs(const SSTV::Mode* mode) {
+		int bits = 9;
+
+		SSTV::ParametricModeParams params {};
+		if (SSTV::GetParametricParams(mode, params))
+			bits += (SSTV::PARAMETRIC_HEADER_SIZE_BITS * 2) + SSTV::PARAMETRIC_HEADER_DWELL_BITS + 2;
+
+		return GetFirstVISBitMs() + (bits * SSTV::The().VIS_LENGTHS_MS[1]);
+	}
+
+	bool SSTVScanner::ReadVIS(std::span<const float> samples, int samplerate, std::int64_t start_smp, std::uint8_t& vis_code) {
+		float bit_ms = SSTV::The().VIS_LENGTHS_MS[1];
+		float first_bit_ms = GetFirstVISBitMs();
+
+		vis_code = 0;
+		bool parity = false;
+
+		for (int i = 0; i < 8; i++) {
+			std::int64_t bit_start = start_smp + static_cast<int>(((first_bit_ms + (i * bit_ms)) / 1000.f) * samplerate);
+
+			bool bitOn = false;
+			if (!ReadHeaderBit(samples, samplerate, bit_start, bitOn))
+				return false;
+
+			if (i < 7) {
+				if (bitOn) {
+					vis_code |= static_cast<std::uint8_t>(1 << i);
+					parity = !parity;
+				}
+			}
+			else if (bitOn != parity) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SSTVScanner::ReadParametricHeader(std::span<const float> samples, int samplerate, std::int64_t start_smp, std::uint8_t vis_code, SSTV::ParametricModeParams& params) {
+		float bit_ms = SSTV::The().VIS_LENGTHS_MS[1];
+
+		// right after the VIS parity and stop bits
+		float pos_ms = GetFirstVISBitMs() + (9 * bit_ms);
+		bool parity = false;
+		bool ok = true;
+
+		auto read_bits = [&](int bits) {
+			int value = 0;
+			for (int i = 0; i < bits; i++, pos_ms += bit_ms) {
+				bool bitOn = false;
+				ok = ok && ReadHeaderBit(samples, samplerate, start_smp + static_cast<int>((pos_ms / 1000.f) * samplerate), bitOn);
+				if (bitOn) {
+					value |= 1 << i;
+					parity = !parity;
+				}
+			}
+
+			return value;
+		};
+
+		params.layout = static_cast<SSTV::ParametricLayout>(vis_code - SSTV::PARAMETRIC_VIS_FIRST);
+		params.width = read_bits(SSTV::PARAMETRIC_HEADER_SIZE_BITS);
+		params.lines = read_bits(SSTV::PARAMETRIC_HEADER_SIZE_BITS);
+		params.pixel_dwell_us = read_bits(SSTV::PARAMETRIC_HEADER_DWELL_BITS) / static_cast<float>(SSTV::PARAMETRIC_DWELL_STEPS_PER_US);
+
+		bool expected_parity = parity;
+		bool parityOn = read_bits(1);
+
+		return ok && parityOn == expected_parity;
+	}
+
+	bool SSTVScanner::ReadBandHeader(std::span<const float> samples, int samplerate, std::int64_t start_smp, const SSTV::Mode* mode, std::vector<SSTV::LineBand>& loop_bands) {
+		SSTV& sstv = SSTV::The();
+		loop_bands.clear();
+
+		if (mode == nullptr)
+			return false;
+
+		float bit_ms = sstv.VIS_LENGTHS_MS[1];
+		float pos_ms = GetBandHeaderMs(mode);
+		auto bit_start = [&]() { return start_smp + static_cast<std::int64_t>((pos_ms / 1000.f) * samplerate); };
+
+		// the marker has to be there for every bit, and be nearer its own frequency than the sync's or a 1's.
+		// a sync pulse only lasts for part of one
+		int bit_smp = (bit_ms / 1000.f) * samplerate;
+		int margin_smp = bit_smp / 6;
+		for (int i = 0; i < SSTV::BAND_HEADER_MARKER_BITS; i++, pos_ms += bit_ms) {
+			std::int64_t from = bit_start() + margin_smp;
+			std::int64_t to = bit_start() + bit_smp - margin_smp;
+			if (from < 0 || to > static_cast<std::int64_t>(samples.size()))
+				return false;
+
+			std::span<const float> window = samples.subspan(from, to - from);
+			float marker = VISGoertzelPower(window, SSTV::BAND_HEADER_MARKER_FREQ, samplerate);
+			if (marker <= VISGoertzelPower(window, sstv.VIS_FREQS[0], samplerate) || marker <= VISGoertzelPower(window, sstv.VIS_BIT_FREQS[1], samplerate))
+				return false;
+		}
+
+		bool parity = false;
+		bool ok = true;
+
+		auto read_bits = [&](int bits) {
+			int value = 0;
+			for (int i = 0; i < bits; i++, pos_ms += bit_ms) {
+				bool bitOn = false;
+				ok = ok && ReadHeaderBit(samples, samplerate, bit_start(), bitOn);
+				if (bitOn) {
+					value |= 1 << i;
+					parity = !parity;
+				}
+			}
+
+			return value;
+		};
+
+		int band_count = read_bits(SSTV::BAND_HEADER_COUNT_BITS);
+		if (!ok || band_count == 0)
+			return false;
+
+		for (int i = 0; i < band_count; i++) {
+			std::uint16_t first = read_bits(SSTV::BAND_HEADER_LOOP_BITS);
+			std::uint16_t count = read_bits(SSTV::BAND_HEADER_LOOP_BITS);
+			loop_bands.push_back({first, count});
+		}
+
+		bool expected_parity = parity;
+		bool parityOn = read_bits(1);
+
+		if (!ok || parityOn != expected_parity || !SSTV::AreLoopBandsValid(mode, loop_bands)) {
+			loop_bands.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	// reads what's at each start the detector found. only the header, then the one transmission, is read at a time
+	std::vector<SSTVScanner::Transmission> ReadTransmissions(const std::vector<std::int64_t>& starts, const SSTVScanner::SampleReader& reader, int samplerate) {
+		std::vector<SSTVScanner::Transmission> transmissions;
+
+		// the detector starts at the VIS, metadata lengths start at the VOX
+		std::vector<SSTV::Instruction> vox;
+		SSTV::CreateVOXHeader(vox);
+		float vox_ms = 0.f;
+		for (auto& ins : vox)
+			vox_ms += ins.length_ms;
+
+		// the VIS (with its parity and stop bits) and the longest parametric header that can follow it
+		const int header_bits = 9 + (SSTV::PARAMETRIC_HEADER_SIZE_BITS * 2) + SSTV::PARAMETRIC_HEADER_DWELL_BITS + 1;
+		const size_t header_smp = ((GetFirstVISBitMs() + (header_bits * SSTV::The().VIS_LENGTHS_MS[1])) / 1000.f) * samplerate;
+
+		std::vector<float> slice;
+		for (std::int64_t start : starts) {
+			SSTVScanner::Transmission transmission {};
+			transmission.start_smp = start;
+
+			reader(start, header_smp, slice);
+			if (!SSTVScanner::ReadVIS(slice, samplerate, 0, transmission.vis_code)) {
+				LogWarning("Couldn't read the VIS of the transmission at {}s", start / (float)samplerate);
+				continue;
+			}
+
+			if (SSTV::IsParametricVIS(transmission.vis_code)) {
+				SSTV::ParametricModeParams params {};
+				if (SSTVScanner::ReadParametricHeader(slice, samplerate, 0, transmission.vis_code, params))
+					transmission.mode = SSTV::CreateParametricMode(params);
+				else
+					LogWarning("Couldn't read the parametric header of the transmission at {}s", start / (float)samplerate);
+			}
+			else {
+				transmission.mode = SSTV::GetMode(transmission.vis_code);
+			}
+
+			SSTVMetadata::PerModeMetadata* modemeta = SSTVMetadata::GetModeMetadata(transmission.mode);
+			if (modemeta != nullptr) {
+				transmission.length_smp = ((modemeta->transmission_length_ms - vox_ms) / 1000.f) * samplerate;
+
+				// a slow clock can push the last syncs past where the mode says it ends. a partial transmission
+				// is never longer than a whole one, so this covers its band header and lines either way
+				std::int64_t from = 0, to = 0;
+				SSTVScanner::GetDecodeRange(transmission, samplerate, from, to);
+				reader(start, to - start, slice);
+
+				// only the bands it says it sent are there, timed after its header
+				std::vector<SSTV::LineBand> loop_bands;
+				if (SSTVScanner::ReadBandHeader(slice, samplerate, 0, transmission.mode, loop_bands)) {
+					std::vector<SSTV::Instruction> instructions;
+					SSTV::CreateInstructions(instructions, transmission.mode, true, &loop_bands);
+
+					float length_ms = 0.f;
+					for (auto& ins : instructions)
+						length_ms += ins.length_ms;
+
+					transmission.length_smp = ((length_ms - vox_ms) / 1000.f) * samplerate;
+				}
+
+				SSTVScanner::MeasureSync(slice, start, samplerate, transmission);
+			}
+
+			transmissions.push_back(transmission);
+		}
+
+		return transmissions;
+	}
+
+	// every transmission with a mode on its own thread, decoded however decode gets at its samples
+	template <typename DecodeFn>
+	std::vector<SSTVScanner::DecodedImage> DecodeAll(const std::vector<SSTVScanner::Transmission>& transmissions, int threads, DecodeFn decode) {
+		std::vector<SSTVScanner::DecodedImage> images(transmissions.size());
+
+#ifdef FASSTV_DEBUG
+		// every decoder would open its own debug window
+		threads = 1;
+#endif
+
+		ThreadPool pool(threads);
+		LogInfo("Decoding {} transmission(s) on {} thread(s)", transmissions.size(), pool.GetThreadCount());
+
+		for (size_t i = 0; i < transmissions.size(); i++) {
+			const SSTVScanner::Transmission& transmission = transmissions[i];
+			images[i].transmission = transmission;
+
+			if (transmission.mode == nullptr)
+				continue;
+
+			// threads left over once every transmission has one help out with lines
+			pool.Submit([&decode, &transmission, &image = images[i], &pool] {
+				image = decode(transmission, &pool);
+			});
+		}
+
+		pool.Wait();
+		return images;
+	}
+
+	std::vector<SSTVScanner::Transmission> SSTVScanner::FindTransmissions(std::span<const float> samples, int samplerate) {
+		SSTVStartDetector detector(samplerate);
+		detector.PushSamples(samples);
+
+		// it's all in memory already, the transmissions are just copied out of it
+		auto reader = [samples](std::int64_t first_smp, size_t count, std::vector<float>& out) {
+			std::span<const float> piece = samples.subspan(std::min<size_t>(first_smp, samples.size()));
+			piece = piece.first(std::min(count, piece.size()));
+			out.assign(piece.begin(), piece.end());
+		};
+
+		return ReadTransmissions(detector.GetStarts(), reader, samplerate);
+	}
+
+	std::vector<SSTVScanner::Transmission> SSTVScanner::FindTransmissions(const SampleReader& reader, std::int64_t sample_count, int samplerate) {
+		SSTVStartDetector detector(samplerate);
+
+		std::vector<float> window;
+		for (std::int64_t pos = 0; pos < sample_count; pos += SCAN_WINDOW) {
+			reader(pos, std::min<std::int64_t>(SCAN_WINDOW, sample_count - pos), window);
+			detector.PushSamples(window);
+		}
+
+		return ReadTransmissions(detector.GetStarts(), reader, samplerate);
+	}
+
+	void SSTVScanner::MeasureSync(std::span<const float> samples, std::int64_t samples_start_smp, int samplerate, Transmission& transmission) {
+		transmission.sync_offsets.clear();
+		transmission.skew_ppm = 0.f;
+
+		if (transmission.mode == nullptr)
+			return;
+
+		SSTV::Mode* mode = transmission.mode;
+
+		// a partial transmission's lines are wherever its band header says, same as the decoder builds them
+		std::vector<SSTV::LineBand> loop_bands;
+		ReadBandHeader(samples, samplerate, transmission.start_smp - samples_start_smp, mode, loop_bands);
+
+		std::vector<SSTV::Instruction> instructions;
+		SSTV::The().CreateInstructions(instructions, mode, true, &loop_bands);
+
+		// everything is timed from the VIS leader, which is where start_smp is
+		std::vector<SSTV::Instruction> vox;
+		SSTV::CreateVOXHeader(vox);
+
+		const int search_smp = (SYNC_SEARCH_MS / 1000.f) * samplerate;
+
+		// exact timing, same as the decoder, so the offsets are what it would need to shift by
+		double pos_ms = 0.0;
+		int last_offset = 0;
+		double power_sum = 0.0;
+		int power_count = 0;
+
+		// for the least squares fit of offset against position
+		double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+		int fit_count = 0;
+
+		for (size_t i = vox.size(); i < instructions.size(); pos_ms += instructions[i].length_ms, i++) {
+			const SSTV::Instruction& ins = instructions[i];
+
+			// only the sync pulse itself, not the porch that shares its type
+			if (ins.type != SSTV::InstructionType::Sync || !(ins.flags & SSTV::InstructionFlags::PitchUsesIndex) || mode->frequencies[ins.pitch] != SSTV::The().VIS_FREQS[0])
+				continue;
+
+			// right after the VIS stop bit there's no edge to line up against
+			const SSTV::Instruction& prev = instructions[i - 1];
+			float prev_pitch = prev.flags & SSTV::InstructionFlags::PitchUsesIndex ? mode->frequencies[prev.pitch] : prev.pitch;
+			if (prev.type != SSTV::InstructionType::Skip && !(prev.flags & SSTV::InstructionFlags::PitchIsDelegated) && prev_pitch == SSTV::The().VIS_FREQS[0]) {
+				transmission.sync_offsets.push_back(SYNC_MISSING);
+				continue;
+			}
+
+			std::int64_t nominal = transmission.start_smp + static_cast<std::int64_t>(std::floor((pos_ms / 1000.0) * samplerate));
+			int width = (ins.length_ms / 1000.f) * samplerate;
+
+			// a window the size of the pulse only gets all of it when lined up exactly
+			float best_power = -1.f;
+			int best_offset = last_offset;
+			for (int offset = last_offset - search_smp; offset <= last_offset + search_smp; offset++) {
+				std::int64_t from = nominal + offset - samples_start_smp;
+				if (from < 0 || from + width > static_cast<std::int64_t>(samples.size()))
+					continue;
+
+				float power = VISGoertzelPower(samples.subspan(from, width), SSTV::The().VIS_FREQS[0], samplerate);
+				if (power > best_power) {
+					best_power = power;
+					best_offset = offset;
+				}
+			}
+
+			// normalise by width, so pulses of different lengths (Robot's line pairs) average together
+			float power_per_smp = best_power / width;
+			if (best_power < 0.f || (power_count > 0 && power_per_smp < (power_sum / power_count) * SYNC_MIN_POWER_RATIO) || best_offset < INT16_MIN + 1 || best_offset > INT16_MAX) {
+				transmission.sync_offsets.push_back(SYNC_MISSING);
+				continue;
+			}
+
+			power_sum += power_per_smp;
+			power_count++;
+
+			last_offset = best_offset;
+			transmission.sync_offsets.push_back(static_cast<std::int16_t>(best_offset));
+
+			double x = nominal - transmission.start_smp;
+			sum_x += x;
+			sum_y += best_offset;
+			sum_xx += x * x;
+			sum_xy += x * best_offset;
+			fit_count++;
+		}
+
+		double denom = (fit_count * sum_xx) - (sum_x * sum_x);
+		if (fit_count >= 2 && denom > 0.0)
+			transmission.skew_ppm = (((fit_count * sum_xy) - (sum_x * sum_y)) / denom) * 1e6;
+	}
+
+	void SSTVScanner::GetDecodeRange(const Transmission& transmission, int samplerate, std::int64_t& from_smp, std::int64_t& to_smp) {
+		// the decoder finds the leader again itself, so give it a little room either side
+		from_smp = std::max<std::int64_t>(0, transmission.start_smp - static_cast<int>(SLICE_LEAD_SECONDS * samplerate));
+		to_smp = transmission.start_smp + transmission.length_smp + static_cast<int>(SLICE_TAIL_SECONDS * samplerate);
+	}
+
+	SSTVScanner::DecodedImage SSTVScanner::DecodeTransmission(std::span<const float> samples, std::int64_t samples_start_smp, int samplerate, const Transmission& transmission, ThreadPool* pool /*= nullptr*/) {
+		DecodedImage image {};
+		image.transmission = transmission;
+
+		if (transmission.mode == nullptr)
+			return image;
+
+		std::int64_t from = 0, to = 0;
+		GetDecodeRange(transmission, samplerate, from, to);
+
+		from = std::clamp<std::int64_t>(from - samples_start_smp, 0, samples.size());
+		to = std::clamp<std::int64_t>(to - samples_start_smp, from, samples.size());
+
+		SSTVDecode decoder;
+		decoder.SetThreadPool(pool);
+
+		// already measured over the whole thing, which beats what the first few lines can say about it
+		int heard = std::count_if(transmission.sync_offsets.begin(), transmission.sync_offsets.end(), [](std::int16_t offset) { return offset != SYNC_MISSING; });
+		if (heard >= SYNC_MIN_FOR_SKEW)
+			decoder.SetExpectedSkew(transmission.skew_ppm);
+		decoder.StartStream(samplerate, transmission.mode, true);
+		decoder.PushSamples(samples.subspan(from, to - from));
+		decoder.FinishStream();
+
+		SSTV::Mode* mode = decoder.GetMode();
+		size_t size = 0;
+		std::uint8_t* pixels = decoder.GetPixels(&size);
+		if (mode == nullptr || pixels == nullptr)
+			return image;
+
+		image.mode = mode;
+		image.pixels.assign(pixels, pixels + size);
+		return image;
+	}
+
+	std::vector<SSTVScanner::DecodedImage> SSTVScanner::DecodeTransmissions(std::span<const float> samples, int samplerate, const std::vector<Transmission>& transmissions, int threads /*= 0*/) {
+		return DecodeAll(transmissions, threads, [samples, samplerate](const Transmission& transmission, ThreadPool* pool) {
+			return DecodeTransmission(samples, 0, samplerate, transmission, pool);
+		});
+	}
+
+	std::vector<SSTVScanner::DecodedImage> SSTVScanner::DecodeTransmissions(const SampleReader& reader, int samplerate, const std::vector<Transmission>& transmissions, int threads /*= 0*/) {
+		// each one only reads its own stretch, so there's only ever a transmission per thread in memory
+		return DecodeAll(transmissions, threads, [&reader, samplerate](const Transmission& transmission, ThreadPool* pool) {
+			std::int64_t from = 0, to = 0;
+			GetDecodeRange(transmission, samplerate, from, to);
+
+			std::vector<float> slice;
+			reader(from, to - from, slice);
+			return DecodeTransmission(slice, from, samplerate, transmission, pool);
+		});
+	}
+
+} // namespace fasstv
@@ -0,0 +1,215 @@
+// Created by block on 2026-10-18.
+
+#include <libfasstv/SSTVStartDetector.hpp>
+#include <libfasstv/SSTV.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace fasstv {
+
+	constexpr float BLOCK_MS = 5.f;
+	constexpr int LEADER_1_BLOCKS_CHECKED = 40; // VOX or whatever else can come right before, so only look at the end of leader 1
+	constexpr int PEAK_SEARCH_BLOCKS = 3;       // the break straddles blocks, keep looking for a better one for a bit
+	constexpr int VIS_BITS = 10;                // start, 7 data, parity, stop
+
+	constexpr float SCORE_THRESHOLD = 0.5f;
+	constexpr float SILENCE_LEVEL = 1e-6f;  // mean square, about -60dBFS
+	constexpr float MIN_TONAL_RATIO = 0.3f; // how much of a block has to be leader or break to count at all
+	constexpr float VIS_SCORE_SCALE = 2.f;  // VIS bits sit off the break frequency and fade quicker in noise, they only need to lean the right way
+	constexpr float SYNC_DOMINANCE = -0.5f; // a block this far towards the break could be a line's sync
+
+	constexpr float HISTORY_KEEP_SECONDS = 2.f;
+	constexpr size_t PUSH_WINDOW = 16384; // samples taken in per step of a big push, so the history never holds more than this past what it keeps
+	constexpr int DOMINANCE_KEEP_BLOCKS = 256;
+	constexpr size_t SYNC_BLOCKS_KEEP = 64;
+
+	SSTVStartDetector::SSTVStartDetector(int samplerate) : samplerate(samplerate) {
+		SSTV& sstv = SSTV::The();
+
+		block_size = std::max(1, static_cast<int>((BLOCK_MS / 1000.f) * samplerate));
+		break_samples = (sstv.VIS_LENGTHS_MS[0] / 1000.f) * samplerate;
+		leader_samples = (sstv.VIS_LENGTHS_MS[2] / 1000.f) * samplerate;
+
+		break_blocks = std::max(1, static_cast<int>(sstv.VIS_LENGTHS_MS[0] / BLOCK_MS));
+		bit_blocks = std::max(1, static_cast<int>(sstv.VIS_LENGTHS_MS[1] / BLOCK_MS));
+		leader_blocks = sstv.VIS_LENGTHS_MS[2] / BLOCK_MS;
+
+		coeff_leader = 2.f * std::cos(2.f * M_PIf * sstv.VIS_FREQS[1] / samplerate);
+		coeff_break = 2.f * std::cos(2.f * M_PIf * sstv.VIS_FREQS[0] / samplerate);
+
+		dominance_sum.push_back(0.0);
+	}
+
+	void SSTVStartDetector::PushSamples(std::span<const float> samples) {
+		if (samplerate <= 0)
+			return;
+
+		// a whole recording at once would otherwise be copied into the history before any of it is trimmed
+		for (size_t i = 0; i < samples.size(); i += PUSH_WINDOW)
+			PushWindow(samples.subspan(i, std::min(PUSH_WINDOW, samples.size() - i)));
+	}
+
+	void SSTVStartDetector::PushWindow(std::span<const float> samples) {
+		history.insert(history.end(), samples.begin(), samples.end());
+		samples_pushed += samples.size();
+
+		ScanBlocks();
+
+		// only the last couple of seconds are needed to line up a break
+		const size_t keep = HISTORY_KEEP_SECONDS * samplerate;
+		if (history.size() > keep * 2) {
+			size_t discard = history.size() - keep;
+			history.erase(history.begin(), history.begin() + discard);
+			history_start_smp += discard;
+		}
+	}
+
+	int SSTVStartDetector::CountSyncBlocksSince(std::int64_t from_smp) const {
+		int count = 0;
+		for (auto it = sync_blocks.rbegin(); it != sync_blocks.rend() && *it >= from_smp; ++it)
+			count++;
+
+		return count;
+	}
+
+	std::span<const float> SSTVStartDetector::GetHistory(std::int64_t from_smp) const {
+		std::int64_t offset = std::clamp<std::int64_t>(from_smp - history_start_smp, 0, history.size());
+		return std::span<const float>(history).subspan(offset);
+	}
+
+	float SSTVStartDetector::GoertzelPower(const float* smp, int count, float coeff) const {
+		float s1 = 0.f, s2 = 0.f;
+		for (int i = 0; i < count; i++) {
+			float s0 = smp[i] + (coeff * s1) - s2;
+			s2 = s1;
+			s1 = s0;
+		}
+
+		return (s1 * s1) + (s2 * s2) - (coeff * s1 * s2);
+	}
+
+	float SSTVStartDetector::BlockDominance(const float* smp) const {
+		float energy = 0.f;
+		for (int i = 0; i < block_size; i++)
+			energy += smp[i] * smp[i];
+
+		// don't bother with the filters through silence
+		if (energy <= SILENCE_LEVEL * block_size)
+			return 0.f;
+
+		float leader = GoertzelPower(smp, block_size, coeff_leader);
+		float brk = GoertzelPower(smp, block_size, coeff_break);
+
+		// a pure tone right on a bin has energy * block_size / 2 worth of power
+		float tonal = (leader + brk) / (energy * block_size * 0.5f);
+		if (tonal < MIN_TONAL_RATIO)
+			return 0.f;
+
+		return (leader - brk) / (leader + brk);
+	}
+
+	float SSTVStartDetector::SegmentMean(std::int64_t first_block, int count) const {
+		size_t first = first_block - dominance_start_block;
+		return (dominance_sum[first + count] - dominance_sum[first]) / count;
+	}
+
+	float SSTVStartDetector::ScoreAt(std::int64_t break_block) const {
+		// matched against leader 1, break, leader 2 and the VIS bits.
+		// segments skip the blocks that a misaligned edge could land in
+		int leader_1_count = std::min(LEADER_1_BLOCKS_CHECKED, leader_blocks);
+		if (break_block - leader_1_count < dominance_start_block)
+			return 0.f;
+
+		float leader_1 = SegmentMean(break_block - leader_1_count, leader_1_count);
+
+		// one of these is completely inside the break, wherever it starts in break_block
+		float brk = 1.f;
+		for (int i = 0; i < break_blocks; i++)
+			brk = std::min(brk, SegmentMean(break_block + i, 1));
+
+		std::int64_t leader_2_first = break_block + break_blocks + 1;
+		float leader_2 = SegmentMean(leader_2_first, leader_blocks - 2);
+
+		// the start bit, data bits, parity and stop bit are all close enough to the break frequency to look the same
+		std::int64_t vis_first = leader_2_first + leader_blocks;
+		float vis = SegmentMean(vis_first, (bit_blocks * VIS_BITS) - 2);
+
+		// every part has to be there, a great leader can't make up for a missing VIS
+		return std::min({ leader_1, -brk, leader_2, -vis * VIS_SCORE_SCALE });
+	}
+
+	void SSTVStartDetector::ScanBlocks() {
+		// demodulate any full blocks we have into the decimated track
+		std::int64_t blocks_done = dominance_start_block + dominance.size();
+		while ((blocks_done + 1) * block_size <= samples_pushed) {
+			float d = BlockDominance(&history[(blocks_done * block_size) - history_start_smp]);
+			dominance.push_back(d);
+			dominance_sum.push_back(dominance_sum.back() + d);
+
+			if (d <= SYNC_DOMINANCE) {
+				if (sync_blocks.size() >= SYNC_BLOCKS_KEEP)
+					sync_blocks.erase(sync_blocks.begin());
+
+				sync_blocks.push_back(blocks_done * block_size);
+			}
+			blocks_done++;
+		}
+
+		// score every break position that has the whole pattern after it
+		const int blocks_after = break_blocks + 1 + leader_blocks + (bit_blocks * VIS_BITS);
+		for (; next_block_to_score + blocks_after < blocks_done; next_block_to_score++) {
+			std::int64_t kb = next_block_to_score;
+
+			float score = kb >= suppress_until_block ? ScoreAt(kb) : 0.f;
+			if (score >= SCORE_THRESHOLD && score > best_score) {
+				best_block = kb;
+				best_score = score;
+			}
+
+			if (best_block >= 0 && kb - best_block >= PEAK_SEARCH_BLOCKS) {
+				std::int64_t break_smp = RefineBreak(best_block * block_size);
+				starts.push_back(break_smp - leader_samples);
+
+				// don't find the same header again
+				suppress_until_block = best_block + (leader_blocks * 2);
+				best_block = -1;
+				best_score = 0.f;
+			}
+		}
+
+		// trim the track, keeping enough for leader 1 of anything we haven't scored yet
+		std::int64_t keep_from = std::min(next_block_to_score, blocks_done) - LEADER_1_BLOCKS_CHECKED - PEAK_SEARCH_BLOCKS;
+		if (keep_from - dominance_start_block > DOMINANCE_KEEP_BLOCKS) {
+			int discard = keep_from - dominance_start_block;
+			dominance.erase(dominance.begin(), dominance.begin() + discard);
+			dominance_start_block += discard;
+
+			dominance_sum.assign(1, 0.0);
+			for (float d : dominance)
+				dominance_sum.push_back(dominance_sum.back() + d);
+		}
+	}
+
+	std::int64_t SSTVStartDetector::RefineBreak(std::int64_t coarse_smp) const {
+		// slide a break-sized window around, the break is where it hears the most break and least leader
+		std::int64_t best_smp = coarse_smp;
+		float best = -INFINITY;
+
+		for (std::int64_t smp = coarse_smp - block_size; smp <= coarse_smp + (block_size * 2); smp++) {
+			std::int64_t offset = smp - history_start_smp;
+			if (offset < 0 || offset + break_samples > static_cast<std::int64_t>(history.size()))
+				continue;
+
+			const float* window = &history[offset];
+			float score = GoertzelPower(window, break_samples, coeff_break) - GoertzelPower(window, break_samples, coeff_leader);
+			if (score > best) {
+				best = score;
+				best_smp = smp;
+			}
+		}
+
+		return best_smp;
+	}
+
+} // namespace fasstv
@@ -46,7 +46,7 @@ namespace fasstv {
 		file.write(&arr[0], sizeof(T));
 	}
 
-	bool SamplesToWAV(std::vector<float>& samples, int samplerate, std::ofstream& file) {
+	bool SamplesToWAV(std::span<const float> samples, int samplerate, std::ofstream& file) {
 		std::streampos startPos = file.tellp();
 		const int channels = 1;
 		const int bitDepth = sizeof(float) * 8;
@@ -89,8 +89,8 @@ namespace fasstv {
 		// DATA chunk
 		//
 		stream_add_str(file, "data");
-		stream_add_num(file, samples.size() * sizeof(float));
-		for (float& smp : samples)
+		stream_add_num<std::uint32_t>(file, samples.size() * sizeof(float));
+		for (float smp : samples)
 			stream_add_num(file, smp);
 
 
@@ -102,8 +102,8 @@ namespace fasstv {
 		return true;
 	}
 
-	bool SamplesToBIN(std::vector<float>& samples, std::ofstream& file) {
-		for (float& smp : samples)
+	bool SamplesToBIN(std::span<const float> samples, std::ofstream& file) {
+		for (float smp : samples)
 			stream_add_num(file, smp);
 
 		return true;
@@ -138,7 +138,7 @@ namespace fasstv {
 		}
 	}
 
-	bool SamplesToAVCodec(std::vector<float>& samples, int samplerate, std::ofstream& file, AVCodecID format /*= AV_CODEC_ID_MP3*/, int bit_rate /*= 320000*/) {
+	bool SamplesToAVCodec(std::span<const float> samples, int samplerate, std::ofstream& file, AVCodecID format /*= AV_CODEC_ID_MP3*/, int bit_rate /*= 320000*/) {
 		int ret = 0;
 
 		LogDebug("Finding encoder");
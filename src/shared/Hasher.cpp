@@ -0,0 +1,114 @@
+// Created by block on 2026-10-18.
+
+#include <shared/Hasher.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace fasstv {
+
+	constexpr std::uint32_t SHA256_K[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	std::uint32_t RotateRight(std::uint32_t x, int n) {
+		return (x >> n) | (x << (32 - n));
+	}
+
+	void Hasher256::ProcessBlock(const std::uint8_t* block) {
+		std::uint32_t w[64];
+		for (int i = 0; i < 16; i++)
+			w[i] = (block[i * 4] << 24) | (block[(i * 4) + 1] << 16) | (block[(i * 4) + 2] << 8) | block[(i * 4) + 3];
+
+		for (int i = 16; i < 64; i++) {
+			std::uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			std::uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+		std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+		for (int i = 0; i < 64; i++) {
+			std::uint32_t t1 = h + (RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+			std::uint32_t t2 = (RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+
+	void Hasher256::Add(const void* data, size_t size) {
+		const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+		total_bytes += size;
+
+		// top up a partial block first
+		if (buffered > 0) {
+			size_t take = std::min(size, sizeof(buffer) - buffered);
+			memcpy(&buffer[buffered], bytes, take);
+			buffered += take;
+			bytes += take;
+			size -= take;
+
+			if (buffered < sizeof(buffer))
+				return;
+
+			ProcessBlock(buffer);
+			buffered = 0;
+		}
+
+		// whole blocks straight from the input
+		for (; size >= sizeof(buffer); bytes += sizeof(buffer), size -= sizeof(buffer))
+			ProcessBlock(bytes);
+
+		memcpy(buffer, bytes, size);
+		buffered = size;
+	}
+
+	Hasher256::Digest Hasher256::Finish() {
+		std::uint64_t total_bits = total_bytes * 8;
+
+		// a one bit, zeroes up to 8 bytes short of a block, then the length
+		std::uint8_t padding[sizeof(buffer) + 8] = { 0x80 };
+		size_t pad = (buffered < 56 ? 56 : 120) - buffered;
+		Add(padding, pad);
+
+		std::uint8_t length[8];
+		for (int i = 0; i < 8; i++)
+			length[i] = static_cast<std::uint8_t>(total_bits >> (56 - (i * 8)));
+		Add(length, sizeof(length));
+
+		Digest digest {};
+		for (int i = 0; i < 8; i++) {
+			digest[i * 4] = static_cast<std::uint8_t>(state[i] >> 24);
+			digest[(i * 4) + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+			digest[(i * 4) + 2] = static_cast<std::uint8_t>(state[i] >> 8);
+			digest[(i * 4) + 3] = static_cast<std::uint8_t>(state[i]);
+		}
+
+		return digest;
+	}
+
+} // namespace fasstv
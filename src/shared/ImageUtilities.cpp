@@ -83,4 +83,43 @@ namespace fasstv {
 		return surfOut;
 	}
 
+	bool ConvertToYUV420P(SDL_Surface* surf, std::vector<std::uint8_t>& buffer, const std::uint8_t* planes[3], int strides[3]) {
+		SDL_Surface* surfConv = SDL_ConvertSurface(surf, SDL_PIXELFORMAT_RGBA32);
+		if (surfConv == nullptr) {
+			LogError("Couldn't convert surface for YUV! {}", SDL_GetError());
+			return false;
+		}
+
+		SwsContext* sws_ctx = sws_getContext(
+			surfConv->w, surfConv->h, AV_PIX_FMT_RGBA,
+			surfConv->w, surfConv->h, AV_PIX_FMT_YUV420P,
+			SWS_BICUBIC, NULL, NULL, NULL
+		);
+
+		if (sws_ctx == nullptr) {
+			LogError("Couldn't set up YUV conversion!");
+			SDL_free(surfConv);
+			return false;
+		}
+
+		std::uint8_t* dst_data[4] = {};
+		int dst_linesize[4] = {};
+		buffer.resize(av_image_get_buffer_size(AV_PIX_FMT_YUV420P, surfConv->w, surfConv->h, 1));
+		av_image_fill_arrays(&dst_data[0], &dst_linesize[0], buffer.data(), AV_PIX_FMT_YUV420P, surfConv->w, surfConv->h, 1);
+
+		int src_linesize[4] = { surfConv->pitch };
+		sws_scale(sws_ctx, reinterpret_cast<const uint8_t* const*>(&(surfConv->pixels)),
+				  src_linesize, 0, surfConv->h, &dst_data[0], &dst_linesize[0]);
+
+		sws_freeContext(sws_ctx);
+		SDL_free(surfConv);
+
+		for (int i = 0; i < 3; i++) {
+			planes[i] = dst_data[i];
+			strides[i] = dst_linesize[i];
+		}
+
+		return true;
+	}
+
 } // namespace fasstv
\ No newline at end of file
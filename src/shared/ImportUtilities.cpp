@@ -0,0 +1,445 @@
+// Created by block on 2026-10-18.
+
+#include <shared/ImportUtilities.hpp>
+#include <shared/Logger.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace fasstv {
+
+	template <typename T>
+	T bytes_read_num(const std::uint8_t* data) {
+		T num;
+		memcpy(&num, data, sizeof(T));
+		return num;
+	}
+
+	float wav_sample_to_float(const std::uint8_t* data, int bytesPerSample, bool isFloat) {
+		if (isFloat) {
+			float smp;
+			memcpy(&smp, data, sizeof(float));
+			return smp;
+		}
+
+		switch (bytesPerSample) {
+			case 1:
+				return (data[0] - 128) / 128.f;
+			case 2:
+				return static_cast<std::int16_t>(data[0] | (data[1] << 8)) / 32768.f;
+			case 3:
+				// shift up to sign extend
+				return static_cast<std::int32_t>((data[0] << 8) | (data[1] << 16) | (static_cast<std::uint32_t>(data[2]) << 24)) / 2147483648.f;
+			case 4:
+				return static_cast<std::int32_t>(data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<std::uint32_t>(data[3]) << 24)) / 2147483648.f;
+			default:
+				return 0.f;
+		}
+	}
+
+	// one loop per sample type and channel count, each simple enough to vectorise
+	template <typename T, int Channels>
+	void wav_frames_to_mono_typed(const std::uint8_t* data, size_t frames, float scale, float offset, float* out) {
+		for (size_t i = 0; i < frames; i++) {
+			float mix = 0.f;
+			for (int c = 0; c < Channels; c++)
+				mix += static_cast<float>(bytes_read_num<T>(&data[((i * Channels) + c) * sizeof(T)]));
+
+			out[i] = (mix * scale) + offset;
+		}
+	}
+
+	template <int Channels>
+	void wav_frames_to_mono_s24(const std::uint8_t* data, size_t frames, float* out) {
+		for (size_t i = 0; i < frames; i++) {
+			float mix = 0.f;
+			for (int c = 0; c < Channels; c++) {
+				const std::uint8_t* smp = &data[((i * Channels) + c) * 3];
+				// shift up to sign extend
+				mix += static_cast<float>(static_cast<std::int32_t>((smp[0] << 8) | (smp[1] << 16) | (static_cast<std::uint32_t>(smp[2]) << 24)));
+			}
+
+			out[i] = mix * (1.f / (2147483648.f * Channels));
+		}
+	}
+
+	template <int Channels>
+	bool wav_frames_to_mono_fast(const std::uint8_t* data, size_t frames, const WAVFormat& format, float* out) {
+		if (format.is_float) {
+			wav_frames_to_mono_typed<float, Channels>(data, frames, 1.f / Channels, 0.f, out);
+			return true;
+		}
+
+		switch (format.bytes_per_sample) {
+			case 1:
+				wav_frames_to_mono_typed<std::uint8_t, Channels>(data, frames, 1.f / (128.f * Channels), -1.f, out);
+				return true;
+			case 2:
+				wav_frames_to_mono_typed<std::int16_t, Channels>(data, frames, 1.f / (32768.f * Channels), 0.f, out);
+				return true;
+			case 3:
+				wav_frames_to_mono_s24<Channels>(data, frames, out);
+				return true;
+			case 4:
+				wav_frames_to_mono_typed<std::int32_t, Channels>(data, frames, 1.f / (2147483648.f * Channels), 0.f, out);
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void wav_frames_to_mono(const std::uint8_t* data, size_t frames, const WAVFormat& format, float* out) {
+		// mono and stereo are nearly everything, anything else takes the slow way
+		if (format.channels == 1 && wav_frames_to_mono_fast<1>(data, frames, format, out))
+			return;
+		if (format.channels == 2 && wav_frames_to_mono_fast<2>(data, frames, format, out))
+			return;
+
+		const size_t frameSize = format.GetFrameSize();
+
+		for (size_t i = 0; i < frames; i++) {
+			float mix = 0.f;
+			for (int c = 0; c < format.channels; c++)
+				mix += wav_sample_to_float(&data[(i * frameSize) + (c * format.bytes_per_sample)], format.bytes_per_sample, format.is_float);
+
+			out[i] = mix / format.channels;
+		}
+	}
+
+	bool ParseWAV(std::span<const std::uint8_t> bytes, WAVFormat& format) {
+		if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) != 0 || memcmp(&bytes[8], "WAVE", 4) != 0) {
+			LogError("Not a WAV file");
+			return false;
+		}
+
+		std::uint16_t formatTag = 0, channels = 0, blockAlign = 0, bitDepth = 0;
+		std::uint32_t rate = 0;
+		bool haveFormat = false;
+
+		// walk the chunks until we hit the data
+		size_t pos = 12;
+		while (pos + 8 <= bytes.size()) {
+			const std::uint8_t* id = &bytes[pos];
+			std::uint32_t size = bytes_read_num<std::uint32_t>(&bytes[pos + 4]);
+			const std::uint8_t* chunk = &bytes[pos + 8];
+			size_t available = bytes.size() - (pos + 8);
+
+			if (memcmp(id, "fmt ", 4) == 0 && size >= 16 && available >= 16) {
+				formatTag = bytes_read_num<std::uint16_t>(&chunk[0]);
+				channels = bytes_read_num<std::uint16_t>(&chunk[2]);
+				rate = bytes_read_num<std::uint32_t>(&chunk[4]);
+				blockAlign = bytes_read_num<std::uint16_t>(&chunk[12]);
+				bitDepth = bytes_read_num<std::uint16_t>(&chunk[14]);
+
+				// WAVE_FORMAT_EXTENSIBLE keeps the real format at the start of the subformat GUID,
+				// and how many of the container's bits are used right before it
+				if (formatTag == 0xFFFE && size >= 26 && available >= 26) {
+					std::uint16_t validBits = bytes_read_num<std::uint16_t>(&chunk[18]);
+					if (validBits != 0)
+						bitDepth = validBits;
+					formatTag = bytes_read_num<std::uint16_t>(&chunk[24]);
+				}
+
+				haveFormat = true;
+			}
+			else if (memcmp(id, "data", 4) == 0) {
+				if (!haveFormat) {
+					LogError("WAV data came before its format");
+					return false;
+				}
+
+				if (rate == 0 || rate > INT32_MAX || channels == 0) {
+					LogError("WAV file claims {} Hz and {} channels", rate, channels);
+					return false;
+				}
+
+				// samples sit in containers blockAlign / channels wide, which can be bigger than
+				// their bit depth (24 bits padded to 32, 12 to 16). the valid bits are at the top,
+				// so reading the whole container as a sample of its size scales them right
+				int containerBytes = blockAlign != 0 && blockAlign % channels == 0 ? blockAlign / channels : (bitDepth + 7) / 8;
+
+				bool isFloat = formatTag == 0x0003;
+				if ((formatTag != 0x0001 && !isFloat) || (isFloat && (bitDepth != 32 || containerBytes != 4)) || bitDepth < 8 || bitDepth > containerBytes * 8 || containerBytes > 4) {
+					LogError("Unsupported WAV format {} ({} bit in {} bytes, {} channels)", formatTag, bitDepth, containerBytes, channels);
+					return false;
+				}
+
+				format.samplerate = rate;
+				format.channels = channels;
+				format.bytes_per_sample = containerBytes;
+				format.is_float = isFloat;
+				format.data_offset = pos + 8;
+				// recordings cut off mid-write claim more data than they have
+				format.data_size = std::min<size_t>(size, available);
+				return true;
+			}
+
+			pos += 8 + static_cast<size_t>(size) + (size & 1);
+		}
+
+		LogError("WAV file has no data");
+		return false;
+	}
+
+	bool SamplesFromWAV(std::ifstream& file, std::vector<float>& samples, int& samplerate) {
+		std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		WAVFormat format {};
+		if (!ParseWAV(bytes, format))
+			return false;
+
+		samples.resize(format.GetFrameCount());
+		wav_frames_to_mono(&bytes[format.data_offset], samples.size(), format, samples.data());
+
+		samplerate = format.samplerate;
+		return true;
+	}
+
+	MappedWAV::~MappedWAV() {
+		Close();
+	}
+
+	bool MappedWAV::Open(const std::filesystem::path& path) {
+		Close();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			LogError("Couldn't open {}", path.string());
+			return false;
+		}
+
+		struct stat st {};
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
+			LogError("Couldn't read {}", path.string());
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (mapped == MAP_FAILED) {
+			LogError("Couldn't map {}", path.string());
+			return false;
+		}
+
+		data = static_cast<std::uint8_t*>(mapped);
+		size = st.st_size;
+
+		if (!ParseWAV(GetBytes(), format)) {
+			Close();
+			return false;
+		}
+
+		// only the bits we seek to get paged in
+		madvise(data, size, MADV_RANDOM);
+		return true;
+	}
+
+	void MappedWAV::Close() {
+		if (data != nullptr)
+			munmap(data, size);
+
+		data = nullptr;
+		size = 0;
+		format = {};
+	}
+
+	void MappedWAV::ReadFrames(size_t first, size_t count, std::vector<float>& samples) const {
+		size_t frames = format.GetFrameCount();
+		first = std::min(first, frames);
+		count = std::min(count, frames - first);
+
+		samples.resize(count);
+		wav_frames_to_mono(data + format.data_offset + (first * format.GetFrameSize()), count, format, samples.data());
+	}
+
+	std::span<const float> MappedWAV::GetFloatSamples() const {
+		// the mapping starts on a page, so it's only the data offset that can throw the alignment off
+		if (data == nullptr || !format.is_float || format.channels != 1 || format.data_offset % alignof(float) != 0)
+			return {};
+
+		return { reinterpret_cast<const float*>(data + format.data_offset), format.GetFrameCount() };
+	}
+
+	std::span<const std::int16_t> MappedWAV::GetInt16Samples() const {
+		if (data == nullptr || format.is_float || format.bytes_per_sample != 2 || format.channels != 1 || format.data_offset % alignof(std::int16_t) != 0)
+			return {};
+
+		return { reinterpret_cast<const std::int16_t*>(data + format.data_offset), format.GetFrameCount() };
+	}
+
+	void MappedWAV::AdviseSequential() const {
+		if (data != nullptr)
+			madvise(data, size, MADV_SEQUENTIAL);
+	}
+
+	void MappedWAV::ReleaseFramesBefore(size_t frame) const {
+		if (data == nullptr)
+			return;
+
+		// whole pages only, the one we're partway through stays
+		const size_t pageSize = sysconf(_SC_PAGESIZE);
+		size_t end = format.data_offset + (std::min(frame, format.GetFrameCount()) * format.GetFrameSize());
+		end -= end % pageSize;
+
+		if (end > 0)
+			madvise(data, end, MADV_DONTNEED);
+	}
+
+	float av_sample_to_float(const std::uint8_t* data, AVSampleFormat sampleFormat) {
+		switch (sampleFormat) {
+			case AV_SAMPLE_FMT_U8:
+			case AV_SAMPLE_FMT_U8P:
+				return (data[0] - 128) / 128.f;
+			case AV_SAMPLE_FMT_S16:
+			case AV_SAMPLE_FMT_S16P:
+				return bytes_read_num<std::int16_t>(data) / 32768.f;
+			case AV_SAMPLE_FMT_S32:
+			case AV_SAMPLE_FMT_S32P:
+				return bytes_read_num<std::int32_t>(data) / 2147483648.f;
+			case AV_SAMPLE_FMT_FLT:
+			case AV_SAMPLE_FMT_FLTP:
+				return bytes_read_num<float>(data);
+			case AV_SAMPLE_FMT_DBL:
+			case AV_SAMPLE_FMT_DBLP:
+				return static_cast<float>(bytes_read_num<double>(data));
+			default:
+				return 0.f;
+		}
+	}
+
+	AVAudioReader::~AVAudioReader() {
+		Close();
+	}
+
+	bool AVAudioReader::Open(const std::filesystem::path& path) {
+		Close();
+
+		int ret = avformat_open_input(&format_ctx, path.c_str(), nullptr, nullptr);
+		if (ret < 0) {
+			LogError("Couldn't open {}", path.string());
+			return false;
+		}
+
+		if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+			LogError("Couldn't read the streams in {}", path.string());
+			Close();
+			return false;
+		}
+
+		const AVCodec* codec = nullptr;
+		stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+		if (stream_index < 0 || codec == nullptr) {
+			LogError("No audio we can decode in {}", path.string());
+			Close();
+			return false;
+		}
+
+		codec_ctx = avcodec_alloc_context3(codec);
+		if (codec_ctx == nullptr || avcodec_parameters_to_context(codec_ctx, format_ctx->streams[stream_index]->codecpar) < 0 || avcodec_open2(codec_ctx, codec, nullptr) < 0) {
+			LogError("Couldn't open a {} decoder for {}", codec->name, path.string());
+			Close();
+			return false;
+		}
+
+		packet = av_packet_alloc();
+		frame = av_frame_alloc();
+		if (packet == nullptr || frame == nullptr) {
+			LogError("Couldn't allocate a frame to decode into");
+			Close();
+			return false;
+		}
+
+		samplerate = codec_ctx->sample_rate;
+		if (format_ctx->duration > 0)
+			duration_seconds = format_ctx->duration / static_cast<float>(AV_TIME_BASE);
+
+		return true;
+	}
+
+	void AVAudioReader::Close() {
+		av_frame_free(&frame);
+		av_packet_free(&packet);
+		avcodec_free_context(&codec_ctx);
+		avformat_close_input(&format_ctx);
+
+		stream_index = -1;
+		draining = false;
+		samplerate = 0;
+		duration_seconds = 0.f;
+	}
+
+	bool AVAudioReader::ReadSamples(std::vector<float>& samples) {
+		if (codec_ctx == nullptr)
+			return false;
+
+		while (true) {
+			int ret = avcodec_receive_frame(codec_ctx, frame);
+			if (ret == 0)
+				break;
+
+			if (ret != AVERROR(EAGAIN)) {
+				if (ret != AVERROR_EOF)
+					LogError("Audio decoder stopped early");
+				return false;
+			}
+
+			// the decoder wants more, feed it the next packet of our stream
+			ret = av_read_frame(format_ctx, packet);
+			if (ret < 0) {
+				// out of packets, get the decoder to hand over whatever it's holding on to
+				if (!draining) {
+					avcodec_send_packet(codec_ctx, nullptr);
+					draining = true;
+					continue;
+				}
+
+				return false;
+			}
+
+			if (packet->stream_index == stream_index) {
+				// a damaged packet is a blip in the audio, not the end of it
+				if (avcodec_send_packet(codec_ctx, packet) < 0)
+					LogWarning("Skipping a packet the decoder couldn't read");
+			}
+
+			av_packet_unref(packet);
+		}
+
+		const AVSampleFormat sampleFormat = static_cast<AVSampleFormat>(frame->format);
+		const int channels = std::max(frame->ch_layout.nb_channels, 1);
+		const int bytesPerSample = av_get_bytes_per_sample(sampleFormat);
+		const bool planar = av_sample_fmt_is_planar(sampleFormat);
+
+		size_t start = samples.size();
+		samples.resize(start + frame->nb_samples);
+
+		for (int i = 0; i < frame->nb_samples; i++) {
+			float mix = 0.f;
+			for (int c = 0; c < channels; c++) {
+				const std::uint8_t* smp = planar ? &frame->extended_data[c][i * bytesPerSample] : &frame->extended_data[0][((i * channels) + c) * bytesPerSample];
+				mix += av_sample_to_float(smp, sampleFormat);
+			}
+
+			samples[start + i] = mix / channels;
+		}
+
+		av_frame_unref(frame);
+		return true;
+	}
+
+} // namespace fasstv
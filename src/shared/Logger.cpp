@@ -24,6 +24,7 @@ namespace fasstv {
 
 		MessageData data { .time = std::chrono::system_clock::now(), .severity = severity, .format = format, .args = args };
 
+		std::lock_guard lock(sinkMutex);
 		for(auto sink : sinks)
 			sink->OutputMessage(data);
 	}
@@ -0,0 +1,133 @@
+// Created by block on 2026-10-18.
+
+#include <shared/ProgressiveImageWriter.hpp>
+
+#include <shared/ExportUtilities.hpp>
+#include <shared/Logger.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace fasstv {
+
+	ProgressiveImageWriter::ProgressiveImageWriter(int every_lines, float every_seconds)
+		: every_lines(every_lines), every(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(every_seconds))) {
+		writer = std::thread(&ProgressiveImageWriter::WriterLoop, this);
+	}
+
+	ProgressiveImageWriter::~ProgressiveImageWriter() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+
+		write_requested.notify_one();
+		writer.join();
+	}
+
+	void ProgressiveImageWriter::Begin(const std::filesystem::path& path, int width, int lines) {
+		End();
+
+		this->width = width;
+		this->lines = lines;
+		front.assign(static_cast<size_t>(width) * lines * 4, 0);
+
+		{
+			// nothing's pending after End, so the writer isn't looking at these
+			std::lock_guard lock(mutex);
+			back.assign(front.size(), 0);
+			this->path = path;
+		}
+
+		dirty_first = lines;
+		dirty_end = 0;
+		lines_since_publish = 0;
+		last_publish = std::chrono::steady_clock::now();
+		active = true;
+	}
+
+	void ProgressiveImageWriter::AddLine(int line, const std::uint8_t* pixels) {
+		if (!active || line < 0 || line >= lines)
+			return;
+
+		const size_t row_bytes = static_cast<size_t>(width) * 4;
+		std::copy_n(pixels, row_bytes, &front[line * row_bytes]);
+
+		dirty_first = std::min(dirty_first, line);
+		dirty_end = std::max(dirty_end, line + 1);
+		lines_since_publish++;
+
+		bool due = every_lines > 0 && lines_since_publish >= every_lines;
+		if (every.count() > 0 && std::chrono::steady_clock::now() - last_publish >= every)
+			due = true;
+
+		if (due)
+			Publish();
+	}
+
+	void ProgressiveImageWriter::End() {
+		if (!active)
+			return;
+
+		std::unique_lock lock(mutex);
+		write_finished.wait(lock, [this] { return !write_pending; });
+		active = false;
+	}
+
+	void ProgressiveImageWriter::Publish() {
+		if (dirty_end <= dirty_first)
+			return;
+
+		{
+			std::lock_guard lock(mutex);
+
+			// still writing the last one, these rows go out with the next
+			if (write_pending)
+				return;
+
+			const size_t row_bytes = static_cast<size_t>(width) * 4;
+			std::copy(&front[dirty_first * row_bytes], &front[dirty_end * row_bytes], &back[dirty_first * row_bytes]);
+			write_pending = true;
+		}
+
+		write_requested.notify_one();
+
+		dirty_first = lines;
+		dirty_end = 0;
+		lines_since_publish = 0;
+		last_publish = std::chrono::steady_clock::now();
+	}
+
+	void ProgressiveImageWriter::WriterLoop() {
+		std::unique_lock lock(mutex);
+
+		while (true) {
+			write_requested.wait(lock, [this] { return write_pending || stopping; });
+			if (!write_pending)
+				return;
+
+			lock.unlock();
+
+			// written next to it then moved over, so nothing watching ever reads half an image
+			std::filesystem::path temp_path = path;
+			temp_path += ".part";
+			{
+				std::ofstream file(temp_path, std::ios::binary);
+				if (file)
+					PixelsToQOI(back.data(), width, lines, file);
+				else
+					LogError("Couldn't write partial image {}", temp_path.string());
+			}
+
+			std::error_code ec;
+			std::filesystem::rename(temp_path, path, ec);
+			if (ec)
+				LogError("Couldn't move {} over {}: {}", temp_path.string(), path.string(), ec.message());
+
+			lock.lock();
+			write_pending = false;
+			write_finished.notify_all();
+		}
+	}
+
+} // namespace fasstv
@@ -0,0 +1,111 @@
+// Created by block on 2026-10-18.
+
+#include <shared/ThreadPool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace fasstv {
+
+	ThreadPool::ThreadPool(int threads /*= 0*/) {
+		if (threads <= 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+
+		workers.reserve(threads);
+		for (int i = 0; i < threads; i++)
+			workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+
+		job_available.notify_all();
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	void ThreadPool::Submit(std::function<void()> job) {
+		{
+			std::lock_guard lock(mutex);
+			jobs.push(std::move(job));
+		}
+
+		job_available.notify_one();
+	}
+
+	void ThreadPool::Wait() {
+		std::unique_lock lock(mutex);
+		jobs_finished.wait(lock, [this] { return jobs.empty() && jobs_running == 0; });
+	}
+
+	void ThreadPool::ParallelFor(int count, const std::function<void(int)>& job) {
+		if (count <= 0)
+			return;
+
+		// helpers can get picked up after we've returned, so what they share outlives us
+		struct Shared {
+			std::atomic<int> next = 0;
+			std::atomic<int> done = 0;
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+
+		auto shared = std::make_shared<Shared>();
+
+		// a helper that starts late finds nothing left and never touches job
+		auto run = [shared, &job, count] {
+			for (int i = shared->next++; i < count; i = shared->next++) {
+				job(i);
+
+				if (++shared->done == count) {
+					std::lock_guard lock(shared->mutex);
+					shared->finished.notify_all();
+				}
+			}
+		};
+
+		int helpers = std::min<int>(count - 1, workers.size());
+		for (int i = 0; i < helpers; i++)
+			Submit(run);
+
+		// if every worker is busy (or we are one), we just end up doing it all ourselves
+		run();
+
+		std::unique_lock lock(shared->mutex);
+		shared->finished.wait(lock, [&] { return shared->done == count; });
+	}
+
+	void ThreadPool::WorkerLoop() {
+		while (true) {
+			std::function<void()> job;
+
+			{
+				std::unique_lock lock(mutex);
+				job_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+				// finish off whatever's queued before leaving
+				if (jobs.empty())
+					return;
+
+				job = std::move(jobs.front());
+				jobs.pop();
+				jobs_running++;
+			}
+
+			job();
+
+			{
+				std::lock_guard lock(mutex);
+				jobs_running--;
+			}
+
+			jobs_finished.notify_all();
+		}
+	}
+
+} // namespace fasstv